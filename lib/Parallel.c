@@ -0,0 +1,268 @@
+/*
+ * Runtime for #[parallel] for loops and the spawn/sync builtins.
+ * Link with libsaphyr.a and -lpthread.
+ *
+ * Tasks run on a pool of threads started on first use. Each thread has its
+ * own deque of tasks: it pushes and pops its tasks at the bottom, and idle
+ * threads steal from the top of the other deques. A thread waiting in sync
+ * runs queued tasks until the tasks it waits for are done.
+ *
+ * The number of threads defaults to the number of online processors and
+ * can be set with the SAPHYR_THREADS environment variable.
+ */
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+/* ranges are split into more chunks than threads so stealing can balance them */
+#define CHUNKS_PER_THREAD 4
+#define DEQUE_INIT_SIZE 64
+
+typedef void (*ChunkFunc)(void* ctx, int64_t lo, int64_t hi);
+typedef void (*TaskFunc)(void* data);
+
+/* the tasks spawned by a running task, or by a thread outside of a task */
+struct Frame
+{
+	atomic_long pending;
+};
+
+struct Task
+{
+	TaskFunc func;
+	void* data;
+	ChunkFunc chunk;
+	void* ctx;
+	int64_t lo;
+	int64_t hi;
+	struct Frame* parent;
+};
+
+struct Deque
+{
+	pthread_mutex_t lock;
+	struct Task** items;
+	size_t size;
+	size_t top;
+	size_t bottom;
+};
+
+static pthread_once_t poolOnce = PTHREAD_ONCE_INIT;
+static long threadCount = 1;
+
+/* deque 0 is shared by the threads that aren't part of the pool */
+static struct Deque* deques = NULL;
+static atomic_long queued = 0;
+static pthread_mutex_t idleLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t idleCond = PTHREAD_COND_INITIALIZER;
+
+static _Thread_local long dequeId = 0;
+static _Thread_local struct Frame rootFrame;
+static _Thread_local struct Frame* currentFrame = NULL;
+
+static int pushTask(struct Task* task)
+{
+	struct Deque* deque = &deques[dequeId];
+	pthread_mutex_lock(&deque->lock);
+	if (deque->bottom - deque->top == deque->size) {
+		size_t newSize = deque->size? deque->size * 2 : DEQUE_INIT_SIZE;
+		struct Task** items = malloc(newSize * sizeof(struct Task*));
+		if (!items) {
+			pthread_mutex_unlock(&deque->lock);
+			return 0;
+		}
+		for (size_t i = deque->top; i < deque->bottom; i++)
+			items[i - deque->top] = deque->items[i % deque->size];
+		free(deque->items);
+		deque->items = items;
+		deque->bottom -= deque->top;
+		deque->top = 0;
+		deque->size = newSize;
+	}
+	deque->items[deque->bottom++ % deque->size] = task;
+	atomic_fetch_add(&queued, 1);
+	pthread_mutex_unlock(&deque->lock);
+
+	pthread_mutex_lock(&idleLock);
+	pthread_cond_signal(&idleCond);
+	pthread_mutex_unlock(&idleLock);
+	return 1;
+}
+
+/* the owner takes its newest task, thieves take the oldest one */
+static struct Task* takeTask(long id, int steal)
+{
+	struct Deque* deque = &deques[id];
+	struct Task* task = NULL;
+	pthread_mutex_lock(&deque->lock);
+	if (deque->top != deque->bottom) {
+		size_t idx = steal? deque->top++ : --deque->bottom;
+		task = deque->items[idx % deque->size];
+	}
+	pthread_mutex_unlock(&deque->lock);
+	if (task)
+		atomic_fetch_sub(&queued, 1);
+	return task;
+}
+
+static struct Task* findTask(void)
+{
+	struct Task* task = takeTask(dequeId, 0);
+	for (long i = 1; !task && i < threadCount; i++)
+		task = takeTask((dequeId + i) % threadCount, 1);
+	return task;
+}
+
+static void runTask(struct Task* task);
+
+/* runs queued tasks until all tasks of the frame are done */
+static void waitFrame(struct Frame* frame)
+{
+	while (atomic_load(&frame->pending)) {
+		struct Task* task = findTask();
+		if (task)
+			runTask(task);
+		else
+			sched_yield();
+	}
+}
+
+static void runTask(struct Task* task)
+{
+	struct Frame frame;
+	atomic_init(&frame.pending, 0);
+	struct Frame* saved = currentFrame;
+	currentFrame = &frame;
+	if (task->chunk)
+		task->chunk(task->ctx, task->lo, task->hi);
+	else
+		task->func(task->data);
+
+	// tasks spawned without a matching sync are waited for when their parent ends
+	waitFrame(&frame);
+	currentFrame = saved;
+
+	struct Frame* parent = task->parent;
+	free(task);
+	atomic_fetch_sub(&parent->pending, 1);
+}
+
+static void* workerMain(void* arg)
+{
+	dequeId = (long) (intptr_t) arg;
+	for (;;) {
+		struct Task* task = findTask();
+		if (task) {
+			runTask(task);
+			continue;
+		}
+		pthread_mutex_lock(&idleLock);
+		while (!atomic_load(&queued))
+			pthread_cond_wait(&idleCond, &idleLock);
+		pthread_mutex_unlock(&idleLock);
+	}
+	return NULL;
+}
+
+static void initPool(void)
+{
+	const char* env = getenv("SAPHYR_THREADS");
+	long count = env? strtol(env, NULL, 10) : sysconf(_SC_NPROCESSORS_ONLN);
+	count = count > 0? count : 1;
+
+	deques = calloc(count, sizeof(struct Deque));
+	if (!deques)
+		return;
+	for (long i = 0; i < count; i++)
+		pthread_mutex_init(&deques[i].lock, NULL);
+	threadCount = count;
+
+	// a thread that fails to start leaves its deque empty
+	pthread_attr_t attr;
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	for (long i = 1; i < count; i++) {
+		pthread_t thread;
+		pthread_create(&thread, &attr, workerMain, (void*) (intptr_t) i);
+	}
+	pthread_attr_destroy(&attr);
+}
+
+static struct Frame* getFrame(void)
+{
+	return currentFrame? currentFrame : &rootFrame;
+}
+
+static int spawnTask(struct Task* task, struct Frame* parent)
+{
+	task->parent = parent;
+	atomic_fetch_add(&parent->pending, 1);
+	if (pushTask(task))
+		return 1;
+	atomic_fetch_sub(&parent->pending, 1);
+	return 0;
+}
+
+/*
+ * Splits [start, end) into chunks that run on the pool. The calling thread
+ * runs the first chunk and returns once all chunks are done.
+ */
+void __saphyr_parallel_for(ChunkFunc func, void* ctx, int64_t start, int64_t end)
+{
+	if (start >= end)
+		return;
+
+	pthread_once(&poolOnce, initPool);
+	int64_t total = end - start;
+	int64_t count = threadCount > 1? threadCount * CHUNKS_PER_THREAD : 1;
+	count = count < total? count : total;
+
+	struct Frame loop;
+	atomic_init(&loop.pending, 0);
+	int64_t step = total / count;
+	int64_t extra = total % count;
+	int64_t lo = start + step + (extra > 0);
+	for (int64_t i = 1; i < count; i++) {
+		int64_t hi = lo + step + (i < extra);
+		struct Task* task = malloc(sizeof(struct Task));
+		if (task) {
+			task->chunk = func;
+			task->ctx = ctx;
+			task->lo = lo;
+			task->hi = hi;
+		}
+		// chunks that can't be queued run on the calling thread
+		if (!task || !spawnTask(task, &loop)) {
+			free(task);
+			func(ctx, lo, hi);
+		}
+		lo = hi;
+	}
+	func(ctx, start, start + step + (extra > 0));
+	waitFrame(&loop);
+}
+
+/* Queues func(data) to run on the pool, or runs it inline if it can't be queued. */
+void __saphyr_spawn(TaskFunc func, void* data)
+{
+	pthread_once(&poolOnce, initPool);
+	struct Task* task = threadCount > 1? malloc(sizeof(struct Task)) : NULL;
+	if (task) {
+		task->func = func;
+		task->data = data;
+		task->chunk = NULL;
+	}
+	if (!task || !spawnTask(task, getFrame())) {
+		free(task);
+		func(data);
+	}
+}
+
+/* Waits for all tasks spawned by the current task or thread. */
+void __saphyr_sync(void)
+{
+	waitFrame(getFrame());
+}
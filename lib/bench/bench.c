@@ -0,0 +1,43 @@
+/*
+ * Scaling benchmark for the parallel runtime. Times a #[parallel] for loop
+ * and the same work split into spawned tasks. Run it with different
+ * SAPHYR_THREADS values, see "make run".
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+void scaleLoop(double* out, int64_t n, int32_t iters);
+void spawnTasks(double* out, int64_t n, int32_t iters, int32_t tasks);
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+int main(int argc, char** argv)
+{
+	int64_t n = argc > 1? atoll(argv[1]) : 1 << 20;
+	int32_t iters = argc > 2? atoi(argv[2]) : 200;
+	const char* env = getenv("SAPHYR_THREADS");
+	int32_t tasks = env? atoi(env) : 4;
+	double* out = malloc(n * sizeof(double));
+	if (!out || tasks < 1)
+		return 1;
+
+	double start = now();
+	scaleLoop(out, n, iters);
+	double loopTime = now() - start;
+
+	start = now();
+	spawnTasks(out, n, iters, tasks);
+	double taskTime = now() - start;
+
+	printf("threads=%s parallel_for=%.3fs spawn=%.3fs check=%g\n",
+		env? env : "default", loopTime, taskTime, out[n - 1]);
+	free(out);
+	return 0;
+}
@@ -550,6 +550,33 @@ public:
 	ADD_ID(NArrayType)
 };
 
+class NSliceType : public NDataType
+{
+	uPtr<Token> lBrac;
+	uPtr<NDataType> baseType;
+
+public:
+	NSliceType(Token* lBrac, NDataType* baseType)
+	: lBrac(lBrac), baseType(baseType) {}
+
+	NSliceType* copy() const override
+	{
+		return new NSliceType(lBrac->copy(), baseType->copy());
+	}
+
+	operator Token*() const override
+	{
+		return lBrac.get();
+	}
+
+	NDataType* getBaseType() const
+	{
+		return baseType.get();
+	}
+
+	ADD_ID(NSliceType)
+};
+
 class NVecType : public NDataType
 {
 	uPtr<NDataType> baseType;
@@ -583,6 +610,35 @@ public:
 	ADD_ID(NVecType)
 };
 
+/**
+ * a constant value (integer or bool) used as a template argument
+ */
+class NConstValueType : public NDataType
+{
+	uPtr<NExpression> value;
+
+public:
+	explicit NConstValueType(NExpression* value)
+	: value(value) {}
+
+	NConstValueType* copy() const override
+	{
+		return new NConstValueType(value->copy());
+	}
+
+	operator Token*() const override
+	{
+		return *value;
+	}
+
+	NExpression* getValue() const
+	{
+		return value.get();
+	}
+
+	ADD_ID(NConstValueType)
+};
+
 class NUserType : public NNamedType
 {
 	uPtr<NDataTypeList> templateArgs;
@@ -720,6 +776,7 @@ class NVariableDecl : public NDeclaration
 	uPtr<NExpression> initExp;
 	uPtr<NExpressionList> initList;
 	NDataType* type = nullptr;
+	NAttributeList* attrs = nullptr;
 
 public:
 	explicit NVariableDecl(Token* name, NExpression* initExp = nullptr)
@@ -732,7 +789,7 @@ public:
 	: NDeclaration(other.getName()->copy()),
 	initExp(other.initExp ? other.initExp->copy() : nullptr),
 	initList(other.initList ? other.initList->copy() : nullptr),
-	type(other.type)
+	type(other.type), attrs(other.attrs)
 	{
 	}
 
@@ -752,6 +809,17 @@ public:
 		type = qtype;
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs;
+	}
+
+	// NOTE: must be called before genCode()
+	void setAttrs(NAttributeList* qattrs)
+	{
+		attrs = qattrs;
+	}
+
 	bool hasInit() const
 	{
 		return initExp || initList;
@@ -857,6 +925,47 @@ public:
 	ADD_ID(NArrayVariable)
 };
 
+class NSliceVariable : public NVariable
+{
+	uPtr<NVariable> arrVar;
+	uPtr<NExpression> start;
+	uPtr<NExpression> end;
+	uPtr<Token> brackTok;
+
+public:
+	NSliceVariable(NVariable* arrVar, Token* brackTok, NExpression* start, NExpression* end)
+	: arrVar(arrVar), start(start), end(end), brackTok(brackTok) {}
+
+	NSliceVariable* copy() const override
+	{
+		auto st = start ? start->copy() : nullptr;
+		auto en = end ? end->copy() : nullptr;
+		return new NSliceVariable(arrVar->copy(), brackTok->copy(), st, en);
+	}
+
+	NExpression* getStart() const
+	{
+		return start.get();
+	}
+
+	NExpression* getEnd() const
+	{
+		return end.get();
+	}
+
+	operator Token*() const override
+	{
+		return brackTok.get();
+	}
+
+	NVariable* getArrayVar() const
+	{
+		return arrVar.get();
+	}
+
+	ADD_ID(NSliceVariable)
+};
+
 class NMemberVariable : public NVariable
 {
 	uPtr<NVariable> baseVar;
@@ -995,14 +1104,16 @@ class NVariableDeclGroup : public NStatement
 {
 	uPtr<NDataType> type;
 	uPtr<NVariableDeclList> variables;
+	uPtr<NAttributeList> attrs;
 
 public:
-	NVariableDeclGroup(NDataType* type, NVariableDeclList* variables)
-	: type(type), variables(variables) {}
+	NVariableDeclGroup(NDataType* type, NVariableDeclList* variables, NAttributeList* attrs = nullptr)
+	: type(type), variables(variables), attrs(attrs) {}
 
 	NVariableDeclGroup* copy() const override
 	{
-		return new NVariableDeclGroup(type->copy(), variables->copy());
+		auto at = attrs ? attrs->copy() : nullptr;
+		return new NVariableDeclGroup(type->copy(), variables->copy(), at);
 	}
 
 	NDataType* getType() const
@@ -1015,6 +1126,11 @@ public:
 		return variables.get();
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs.get();
+	}
+
 	ADD_ID(NVariableDeclGroup)
 };
 using NVariableDeclGroupList = NodeList<NVariableDeclGroup>;
@@ -1124,22 +1240,22 @@ public:
 	ADD_ID(NEnumDeclaration)
 };
 
-class NFunctionDeclaration : public NDeclaration
+class NFunctionDeclaration : public NTemplatedDeclaration
 {
 	uPtr<NDataType> rtype;
 	uPtr<NParameterList> params;
 	uPtr<NStatementList> body;
-	uPtr<NAttributeList> attrs;
 
 public:
-	NFunctionDeclaration(Token* name, NDataType* rtype, NParameterList* params, NStatementList* body = nullptr, NAttributeList* attrs = nullptr)
-	: NDeclaration(name), rtype(rtype), params(params), body(body), attrs(attrs) {}
+	NFunctionDeclaration(Token* name, NDataType* rtype, NParameterList* params, NStatementList* body = nullptr, NAttributeList* attrs = nullptr, NIdentifierList* templateParams = nullptr)
+	: NTemplatedDeclaration(name, templateParams, attrs), rtype(rtype), params(params), body(body) {}
 
 	NFunctionDeclaration* copy() const override
 	{
 		auto bd = body ? body->copy() : nullptr;
-		auto at = attrs ? attrs->copy() : nullptr;
-		return new NFunctionDeclaration(getName()->copy(), rtype->copy(), params->copy(), bd, at);
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		auto tp = getTemplateParams() ? getTemplateParams()->copy() : nullptr;
+		return new NFunctionDeclaration(getName()->copy(), rtype->copy(), params->copy(), bd, at, tp);
 	}
 
 	NDataType* getRType() const
@@ -1157,11 +1273,6 @@ public:
 		return body.get();
 	}
 
-	NAttributeList* getAttrs() const
-	{
-		return attrs.get();
-	}
-
 	ADD_ID(NFunctionDeclaration)
 };
 
@@ -1387,14 +1498,16 @@ class NConditionStmt : public NStatement
 {
 	uPtr<NExpression> condition;
 	uPtr<NStatementList> body;
+	uPtr<NAttributeList> attrs;
 
 public:
-	NConditionStmt(NExpression* condition, NStatementList* body)
-	: condition(condition), body(body) {}
+	NConditionStmt(NExpression* condition, NStatementList* body, NAttributeList* attrs = nullptr)
+	: condition(condition), body(body), attrs(attrs) {}
 
 	NConditionStmt* copy() const override
 	{
-		return new NConditionStmt(condition->copy(), body->copy());
+		auto at = attrs ? attrs->copy() : nullptr;
+		return new NConditionStmt(condition->copy(), body->copy(), at);
 	}
 
 	bool isBlockStmt() const override
@@ -1412,18 +1525,24 @@ public:
 		return body.get();
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs.get();
+	}
+
 	ADD_ID(NConditionStmt)
 };
 
 class NLoopStatement : public NConditionStmt
 {
 public:
-	explicit NLoopStatement(NStatementList* body)
-	: NConditionStmt(nullptr, body) {}
+	explicit NLoopStatement(NStatementList* body, NAttributeList* attrs = nullptr)
+	: NConditionStmt(nullptr, body, attrs) {}
 
 	NLoopStatement* copy() const override
 	{
-		return new NLoopStatement(getBody()->copy());
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		return new NLoopStatement(getBody()->copy(), at);
 	}
 
 	ADD_ID(NLoopStatement)
@@ -1435,13 +1554,14 @@ class NWhileStatement : public NConditionStmt
 	bool isUntil;
 
 public:
-	NWhileStatement(NExpression* condition, NStatementList* body, bool isDoWhile = false, bool isUntil = false)
-	: NConditionStmt(condition, body), isDoWhile(isDoWhile), isUntil(isUntil) {}
+	NWhileStatement(NExpression* condition, NStatementList* body, bool isDoWhile = false, bool isUntil = false, NAttributeList* attrs = nullptr)
+	: NConditionStmt(condition, body, attrs), isDoWhile(isDoWhile), isUntil(isUntil) {}
 
 	NWhileStatement* copy() const override
 	{
 		auto cn = getCond() ? getCond()->copy() : nullptr;
-		return new NWhileStatement(cn, getBody()->copy(), isDoWhile, isUntil);
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		return new NWhileStatement(cn, getBody()->copy(), isDoWhile, isUntil, at);
 	}
 
 	bool doWhile() const
@@ -1460,17 +1580,21 @@ public:
 class NSwitchCase : public NStatement
 {
 	uPtr<NExpression> value;
+	uPtr<NExpression> endValue;
 	uPtr<NStatementList> body;
 	uPtr<Token> token;
+	uPtr<NAttributeList> attrs;
 
 public:
-	NSwitchCase(Token* token, NStatementList* body, NExpression* value = nullptr)
-	: value(value), body(body), token(token) {}
+	NSwitchCase(Token* token, NStatementList* body, NExpression* value = nullptr, NAttributeList* attrs = nullptr, NExpression* endValue = nullptr)
+	: value(value), endValue(endValue), body(body), token(token), attrs(attrs) {}
 
 	NSwitchCase* copy() const override
 	{
 		auto vl = value ? value->copy() : nullptr;
-		return new NSwitchCase(token->copy(), body->copy(), vl);
+		auto ev = endValue ? endValue->copy() : nullptr;
+		auto at = attrs ? attrs->copy() : nullptr;
+		return new NSwitchCase(token->copy(), body->copy(), vl, at, ev);
 	}
 
 	NExpression* getValue() const
@@ -1478,11 +1602,21 @@ public:
 		return value.get();
 	}
 
+	NExpression* getEndValue() const
+	{
+		return endValue.get();
+	}
+
 	NStatementList* getBody() const
 	{
 		return body.get();
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs.get();
+	}
+
 	operator Token*() const
 	{
 		return token.get();
@@ -1493,6 +1627,11 @@ public:
 		return value.get();
 	}
 
+	bool isRangeCase() const
+	{
+		return endValue.get();
+	}
+
 	bool isLastStmBranch() const
 	{
 		auto last = body->back();
@@ -1543,13 +1682,14 @@ class NForStatement : public NConditionStmt
 	uPtr<NExpressionList> postExp;
 
 public:
-	NForStatement(NStatementList* preStm, NExpression* condition, NExpressionList* postExp, NStatementList* body)
-	: NConditionStmt(condition, body), preStm(preStm), postExp(postExp) {}
+	NForStatement(NStatementList* preStm, NExpression* condition, NExpressionList* postExp, NStatementList* body, NAttributeList* attrs = nullptr)
+	: NConditionStmt(condition, body, attrs), preStm(preStm), postExp(postExp) {}
 
 	NForStatement* copy() const override
 	{
 		auto cn = getCond() ? getCond()->copy() : nullptr;
-		return new NForStatement(preStm->copy(), cn, postExp->copy(), getBody()->copy());
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		return new NForStatement(preStm->copy(), cn, postExp->copy(), getBody()->copy(), at);
 	}
 
 	NStatementList* getPreStm() const
@@ -1565,18 +1705,47 @@ public:
 	ADD_ID(NForStatement)
 };
 
+class NForEachStatement : public NConditionStmt
+{
+	uPtr<NDataType> type;
+	uPtr<Token> name;
+
+public:
+	NForEachStatement(NDataType* type, Token* name, NExpression* sequence, NStatementList* body, NAttributeList* attrs = nullptr)
+	: NConditionStmt(sequence, body, attrs), type(type), name(name) {}
+
+	NForEachStatement* copy() const override
+	{
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		return new NForEachStatement(type->copy(), name->copy(), getCond()->copy(), getBody()->copy(), at);
+	}
+
+	NDataType* getType() const
+	{
+		return type.get();
+	}
+
+	Token* getName() const
+	{
+		return name.get();
+	}
+
+	ADD_ID(NForEachStatement)
+};
+
 class NIfStatement : public NConditionStmt
 {
 	uPtr<NStatementList> elseBody;
 
 public:
-	NIfStatement(NExpression* condition, NStatementList* ifBody, NStatementList* elseBody = nullptr)
-	: NConditionStmt(condition, ifBody), elseBody(elseBody) {}
+	NIfStatement(NExpression* condition, NStatementList* ifBody, NStatementList* elseBody = nullptr, NAttributeList* attrs = nullptr)
+	: NConditionStmt(condition, ifBody, attrs), elseBody(elseBody) {}
 
 	NIfStatement* copy() const override
 	{
 		auto el = elseBody ? elseBody->copy() : nullptr;
-		return new NIfStatement(getCond()->copy(), getBody()->copy(), el);
+		auto at = getAttrs() ? getAttrs()->copy() : nullptr;
+		return new NIfStatement(getCond()->copy(), getBody()->copy(), el, at);
 	}
 
 	NStatementList* getElseBody() const
@@ -1616,16 +1785,18 @@ class NReturnStatement : public NJumpStatement
 {
 	uPtr<NExpression> value;
 	uPtr<Token> retToken;
+	uPtr<NAttributeList> attrs;
 
 public:
-	NReturnStatement(Token* retToken, NExpression* value = nullptr)
-	: value(value), retToken(retToken) {}
+	NReturnStatement(Token* retToken, NExpression* value = nullptr, NAttributeList* attrs = nullptr)
+	: value(value), retToken(retToken), attrs(attrs) {}
 
 	NReturnStatement* copy() const override
 	{
 		auto rt = retToken ? retToken->copy() : nullptr;
 		auto vl = value ? value->copy() : nullptr;
-		return new NReturnStatement(rt, vl);
+		auto at = attrs ? attrs->copy() : nullptr;
+		return new NReturnStatement(rt, vl, at);
 	}
 
 	NExpression* getValue() const
@@ -1633,6 +1804,11 @@ public:
 		return value.get();
 	}
 
+	NAttributeList* getAttrs() const
+	{
+		return attrs.get();
+	}
+
 	operator Token*() const override
 	{
 		return retToken.get();
@@ -1641,6 +1817,61 @@ public:
 	ADD_ID(NReturnStatement)
 };
 
+class NYieldStatement : public NStatement
+{
+	uPtr<Token> token;
+	uPtr<NExpression> value;
+
+public:
+	NYieldStatement(Token* token, NExpression* value = nullptr)
+	: token(token), value(value) {}
+
+	NYieldStatement* copy() const override
+	{
+		auto vl = value ? value->copy() : nullptr;
+		return new NYieldStatement(token->copy(), vl);
+	}
+
+	NExpression* getValue() const
+	{
+		return value.get();
+	}
+
+	operator Token*() const
+	{
+		return token.get();
+	}
+
+	ADD_ID(NYieldStatement)
+};
+
+class NAwaitStatement : public NStatement
+{
+	uPtr<Token> token;
+	uPtr<NExpression> value;
+
+public:
+	NAwaitStatement(Token* token, NExpression* value)
+	: token(token), value(value) {}
+
+	NAwaitStatement* copy() const override
+	{
+		return new NAwaitStatement(token->copy(), value->copy());
+	}
+
+	NExpression* getValue() const
+	{
+		return value.get();
+	}
+
+	operator Token*() const
+	{
+		return token.get();
+	}
+
+	ADD_ID(NAwaitStatement)
+};
+
 class NGotoStatement : public NJumpStatement
 {
 	uPtr<Token> name;
@@ -1705,14 +1936,16 @@ class NDeleteStatement : public NStatement
 {
 	uPtr<NVariable> variable;
 	uPtr<NExpression> arrSize;
+	uPtr<NExpression> allocator;
 
 public:
-	explicit NDeleteStatement(NVariable* variable, NExpression* arrSize = nullptr)
-	: variable(variable), arrSize(arrSize) {}
+	explicit NDeleteStatement(NVariable* variable, NExpression* arrSize = nullptr, NExpression* allocator = nullptr)
+	: variable(variable), arrSize(arrSize), allocator(allocator) {}
 
 	NDeleteStatement* copy() const override
 	{
-		return new NDeleteStatement(variable->copy(), arrSize ? arrSize->copy() : nullptr);
+		auto al = allocator ? allocator->copy() : nullptr;
+		return new NDeleteStatement(variable->copy(), arrSize ? arrSize->copy() : nullptr, al);
 	}
 
 	NVariable* getVar() const
@@ -1725,6 +1958,11 @@ public:
 		return arrSize.get();
 	}
 
+	NExpression* getAllocator() const
+	{
+		return allocator.get();
+	}
+
 	ADD_ID(NDeleteStatement)
 };
 
@@ -1851,15 +2089,17 @@ class NNewExpression : public NExpression
 	uPtr<NDataType> type;
 	uPtr<Token> token;
 	uPtr<NExpressionList> args;
+	uPtr<NExpression> allocator;
 
 public:
-	NNewExpression(Token* token, NDataType* type, NExpressionList* args = nullptr)
-	: type(type), token(token), args(args) {}
+	NNewExpression(Token* token, NDataType* type, NExpressionList* args = nullptr, NExpression* allocator = nullptr)
+	: type(type), token(token), args(args), allocator(allocator) {}
 
 	NNewExpression* copy() const override
 	{
 		auto ar = args ? args->copy() : nullptr;
-		return new NNewExpression(token->copy(), type->copy(), ar);
+		auto al = allocator ? allocator->copy() : nullptr;
+		return new NNewExpression(token->copy(), type->copy(), ar, al);
 	}
 
 	NDataType* getType() const
@@ -1872,6 +2112,11 @@ public:
 		return args.get();
 	}
 
+	NExpression* getAllocator() const
+	{
+		return allocator.get();
+	}
+
 	operator Token*() const override
 	{
 		return token.get();
@@ -1886,14 +2131,16 @@ class NLambdaFunction : public NExpression
 	uPtr<NParameterList> params;
 	uPtr<NDataType> returnType;
 	uPtr<NStatementList> body;
+	uPtr<NExpressionList> captures;
 
 public:
-	NLambdaFunction(Token* lbar, NParameterList* params, NDataType* rtype, NStatementList* body)
-	: lBar(lbar), params(params), returnType(rtype), body(body) {}
+	NLambdaFunction(Token* lbar, NParameterList* params, NDataType* rtype, NStatementList* body, NExpressionList* captures = nullptr)
+	: lBar(lbar), params(params), returnType(rtype), body(body), captures(captures) {}
 
 	NLambdaFunction* copy() const override
 	{
-		return new NLambdaFunction(lBar->copy(), params->copy(), returnType->copy(), body->copy());
+		auto cp = captures ? captures->copy() : nullptr;
+		return new NLambdaFunction(lBar->copy(), params->copy(), returnType->copy(), body->copy(), cp);
 	}
 
 	NParameterList* getParams() const
@@ -1911,6 +2158,14 @@ public:
 		return body.get();
 	}
 
+	/**
+	 * @return captured variables, NAddressOf items are captured by reference
+	 */
+	NExpressionList* getCaptures() const
+	{
+		return captures.get();
+	}
+
 	operator Token*() const override
 	{
 		return lBar.get();
@@ -2093,14 +2348,24 @@ class NFunctionCall : public NVariable
 {
 	uPtr<Token> name;
 	uPtr<NExpressionList> arguments;
+	uPtr<NDataTypeList> templateArgs;
 
 public:
-	NFunctionCall(Token* name, NExpressionList* arguments)
-	: name(name), arguments(arguments) {}
+	NFunctionCall(Token* name, NExpressionList* arguments, NDataTypeList* templateArgs = nullptr)
+	: name(name), arguments(arguments), templateArgs(templateArgs) {}
 
 	NFunctionCall* copy() const override
 	{
-		return new NFunctionCall(name->copy(), arguments->copy());
+		auto ta = templateArgs ? templateArgs->copy() : nullptr;
+		return new NFunctionCall(name->copy(), arguments->copy(), ta);
+	}
+
+	/**
+	 * @return explicit function template arguments
+	 */
+	NDataTypeList* getTemplateArgs() const
+	{
+		return templateArgs.get();
 	}
 
 	operator Token*() const override
@@ -34,10 +34,12 @@ enum class NodeId
 	NArrayType,
 	NBaseType,
 	NConstType,
+	NConstValueType,
 	NFuncPointerType,
 	NPointerType,
 	NReferenceType,
 	NCopyReferenceType,
+	NSliceType,
 	NThisType,
 	NUserType,
 	NVecType,
@@ -65,12 +67,14 @@ enum class NodeId
 	NNewExpression,
 	NNullCoalescing,
 	NNullPointer,
+	NSliceVariable,
 	NStringLiteral,
 	NTernaryOperator,
 	NUnaryMathOperator,
 
 	// statements
 	NAliasDeclaration,
+	NAwaitStatement,
 	NClassConstructor,
 	NClassDeclaration,
 	NClassDestructor,
@@ -81,6 +85,7 @@ enum class NodeId
 	NDestructorCall,
 	NEnumDeclaration,
 	NExpressionStm,
+	NForEachStatement,
 	NForStatement,
 	NFunctionDeclaration,
 	NGlobalVariableDecl,
@@ -102,6 +107,7 @@ enum class NodeId
 	NVariableDecl,
 	NVariableDeclGroup,
 	NWhileStatement,
+	NYieldStatement,
 };
 
 #define ADD_ID(CLASS) NodeId id() const override { return NodeId::CLASS; }
@@ -16,6 +16,10 @@
  */
 
 #include <numeric>
+#include <llvm/ADT/Triple.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/Intrinsics.h>
+#include <llvm/Transforms/Utils/Evaluator.h>
 #include "AST.h"
 #include "SParser.h"
 #include "Value.h"
@@ -23,6 +27,7 @@
 #include "Instructions.h"
 #include "CGNDataType.h"
 #include "CGNExpression.h"
+#include "CGNVariable.h"
 #include "CGNStatement.h"
 #include "CGNImportStm.h"
 #include "Instructions.h"
@@ -34,7 +39,18 @@ SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType*
 	auto funcType = getFuncType(context, rtype, params);
 	if (!funcType)
 		return SFunction();
-	auto linkage = context.inTemplate() ? GlobalValue::LinkageTypes::WeakAnyLinkage : GlobalValue::LinkageTypes::ExternalLinkage;
+	auto yieldType = funcType->returnTy();
+	auto async = NAttributeList::find(attrs, "async");
+	if (async) {
+		funcType = getAsyncFuncType(context, funcType, name);
+		if (!funcType)
+			return SFunction();
+	}
+	auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+	if (context.inTemplate()) {
+		// function template instances can be inlined, unlike class template functions
+		linkage = context.getClass() ? GlobalValue::LinkageTypes::WeakAnyLinkage : GlobalValue::LinkageTypes::LinkOnceODRLinkage;
+	}
 	auto function = getFuncPrototype(context, name, funcType, linkage, attrs);
 	if (!function || !body) {
 		return function;
@@ -45,13 +61,19 @@ SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType*
 
 	if (body->empty() || !body->back()->isTerminator()) {
 		auto returnType = function.returnTy();
-		if (returnType->isVoid())
+		// async functions can finish without a final value
+		if (async || returnType->isVoid())
 			body->add(new NReturnStatement(name->copy()));
 		else
 			context.addError("no return for a non-void function", name);
 	}
 
 	context.startFuncBlock(function);
+	auto debugInfo = context.getDebugInfo();
+	if (debugInfo)
+		debugInfo->startFunction(context, function, name);
+	if (async)
+		CreateCoroutineBegin(context, yieldType, name);
 
 	int i = 0;
 	set<string> names;
@@ -68,10 +90,232 @@ SFunction Builder::CreateFunction(CodeContext& context, Token* name, NDataType*
 	}
 
 	CGNStatement::run(context, body);
+	if (async)
+		CreateCoroutineEnd(context, name);
+	if (debugInfo)
+		debugInfo->endFunction(context);
 	context.endFuncBlock();
 	return function;
 }
 
+SFunctionType* Builder::getAsyncFuncType(CodeContext& context, SFunctionType* funcType, Token* name)
+{
+	auto promiseType = funcType->returnTy();
+	if (promiseType->isVoid()) {
+		promiseType = SType::getInt(context, 8);
+	} else if (promiseType->isDestructable()) {
+		context.addError("async function can not return a destructable type", name);
+		return nullptr;
+	}
+
+	// async functions return a pointer to their promise value
+	VecSType params;
+	for (size_t i = 0; i < funcType->numParams(); i++)
+		params.push_back(funcType->getParam(i));
+	return SType::getFunction(context, SType::getAsync(context, promiseType), params);
+}
+
+void Builder::CreateCoroutineBegin(CodeContext& context, SType* yieldType, Token* name)
+{
+	auto& IB = context.IB();
+	auto module = context.getModule();
+	auto bytePtrTy = SType::getPointer(context, SType::getInt(context, 8));
+	auto nullPtr = ConstantPointerNull::get(static_cast<PointerType*>(bytePtrTy->type()));
+
+	CoroutineState state;
+	state.yieldType = yieldType;
+	auto promiseType = context.currFunction().returnTy()->subType();
+	auto align = SType::allocAlign(context, promiseType);
+	state.promise = RValue(Inst::Alloca(context, promiseType, "promise", align), promiseType);
+
+	auto promisePtr = IB.CreateBitCast(state.promise, *bytePtrTy);
+	auto idFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_id);
+	state.id = IB.CreateCall(idFunc, {IB.getInt32(align), promisePtr, nullPtr, nullPtr});
+
+	// the frame allocation is skipped when the coroutine passes elide it
+	auto allocFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_alloc);
+	auto needAlloc = IB.CreateCall(allocFunc, {state.id});
+	auto entryBlock = context.currBlock();
+	auto allocBlock = context.createBlock();
+	auto beginBlock = context.createBlock();
+	IB.CreateCondBr(needAlloc, allocBlock, beginBlock);
+
+	context.pushBlock(allocBlock);
+	auto sizeFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_size, {IB.getInt64Ty()});
+	RValue size(IB.CreateCall(sizeFunc), SType::getInt(context, 64));
+	Value* frame;
+	auto allocator = context.getAllocator();
+	if (allocator) {
+		VecRValue allocArgs{size, RValue::getNumVal(context, 16, 64)};
+		auto ptr = CallAllocator(context, allocator, name, "alloc", allocArgs);
+		if (!ptr || !ptr.stype()->isPointer()) {
+			if (ptr)
+				context.addError("allocator alloc function must return a pointer", name);
+			frame = nullPtr;
+		} else {
+			frame = IB.CreateBitCast(ptr, *bytePtrTy);
+		}
+	} else {
+		auto mallocFunc = getBuiltinFunc(context, name, BuiltinFuncType::Malloc);
+		frame = IB.CreateCall(mallocFunc.funcType(), mallocFunc.value(), {size.value()});
+	}
+	auto allocEnd = context.currBlock();
+	IB.CreateBr(beginBlock);
+
+	context.pushBlock(beginBlock);
+	auto mem = IB.CreatePHI(*bytePtrTy, 2);
+	mem->addIncoming(nullPtr, entryBlock);
+	mem->addIncoming(frame, allocEnd);
+	auto beginFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_begin);
+	state.handle = IB.CreateCall(beginFunc, {state.id, mem});
+
+	state.finalBlock = context.createBlock();
+	state.cleanupBlock = context.createBlock();
+	state.suspendBlock = context.createBlock();
+	context.setCoroutine(state);
+
+	// CoroSplit only lowers functions marked as unsplit coroutines
+#if LLVM_VERSION_MAJOR >= 15
+	context.currFunction().funcValue()->addFnAttr(Attribute::PresplitCoroutine);
+#else
+	context.currFunction().funcValue()->addFnAttr("coroutine.presplit", "1");
+#endif
+	// CoroElide only removes the frame allocation once the ramp is inlined into its caller
+	context.currFunction().funcValue()->addFnAttr(Attribute::AlwaysInline);
+}
+
+void Builder::CreateCoroutineSuspend(CodeContext& context, BasicBlock* resumeBlock, Token* token, RValue awaited)
+{
+	auto& IB = context.IB();
+	auto coro = context.getCoroutine();
+	auto suspendFunc = Intrinsic::getDeclaration(context.getModule(), Intrinsic::coro_suspend);
+	auto state = IB.CreateCall(suspendFunc, {ConstantTokenNone::get(context), IB.getInt1(!resumeBlock)});
+
+	// the final suspend point is reached after the locals were destroyed
+	auto destroyBlock = coro->cleanupBlock;
+	auto hasLocals = resumeBlock && !context.getDestructables(0).empty();
+	if (hasLocals || awaited)
+		destroyBlock = context.createBlock();
+
+	// 0 = resumed, 1 = destroyed, otherwise return to the caller
+	auto sw = IB.CreateSwitch(state, coro->suspendBlock, 2);
+	if (resumeBlock)
+		sw->addCase(IB.getInt8(0), resumeBlock);
+	sw->addCase(IB.getInt8(1), destroyBlock);
+
+	if (destroyBlock != coro->cleanupBlock) {
+		context.pushBlock(destroyBlock);
+		if (awaited) {
+			VecRValue args{awaited};
+			CallCoroutine(context, BuiltinCallType::Destroy, token, args);
+		}
+		Inst::CallDestructables(context, nullptr, token);
+		IB.CreateBr(coro->cleanupBlock);
+	}
+}
+
+void Builder::CreateCoroutineEnd(CodeContext& context, Token* name)
+{
+	auto& IB = context.IB();
+	auto module = context.getModule();
+	auto coro = context.getCoroutine();
+	auto bytePtrTy = SType::getPointer(context, SType::getInt(context, 8));
+
+	context.pushBlock(coro->finalBlock);
+	CreateCoroutineSuspend(context, nullptr, name);
+
+	context.pushBlock(coro->cleanupBlock);
+	auto freeFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_free);
+	RValue mem(IB.CreateCall(freeFunc, {coro->id, coro->handle}), bytePtrTy);
+	auto freeBlock = context.createBlock();
+	IB.CreateCondBr(IB.CreateIsNotNull(mem), freeBlock, coro->suspendBlock);
+
+	context.pushBlock(freeBlock);
+	auto allocator = context.getAllocator();
+	if (allocator) {
+		auto sizeFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_size, {IB.getInt64Ty()});
+		VecRValue freeArgs{mem, RValue(IB.CreateCall(sizeFunc), SType::getInt(context, 64))};
+		CallAllocator(context, allocator, name, "free", freeArgs);
+	} else {
+		auto func = getBuiltinFunc(context, name, BuiltinFuncType::Free);
+		IB.CreateCall(func.funcType(), func.value(), {mem.value()});
+	}
+	IB.CreateBr(coro->suspendBlock);
+
+	context.pushBlock(coro->suspendBlock);
+	auto endFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_end);
+#if LLVM_VERSION_MAJOR >= 16
+	IB.CreateCall(endFunc, {coro->handle, IB.getFalse(), ConstantTokenNone::get(context)});
+#else
+	IB.CreateCall(endFunc, {coro->handle, IB.getFalse()});
+#endif
+	IB.CreateRet(coro->promise.value());
+}
+
+RValue Builder::CreateClosure(CodeContext& context, NLambdaFunction* exp, Token* name)
+{
+	// the captured variables become members of a closure class
+	VecRValue values;
+	vector<pair<string, SType*>> members;
+	set<string> names;
+	for (auto capture : *exp->getCaptures()) {
+		auto byRef = capture->id() == NodeId::NAddressOf;
+		auto var = byRef? static_cast<NAddressOf*>(capture)->getVar() : static_cast<NVariable*>(capture);
+		Token* varTok = *var;
+		if (!names.insert(varTok->str).second) {
+			context.addError("variable " + varTok->str + " already captured", varTok);
+			return {};
+		}
+
+		RValue value;
+		SType* memberType;
+		if (byRef) {
+			value = CGNVariable::run(context, var);
+			if (!value)
+				return {};
+			else if (value.stype()->isReference())
+				value = Inst::Load(context, value);
+			auto type = value.stype()->isReference()? value.stype()->subType() : value.stype();
+			memberType = SType::getReference(context, type);
+		} else {
+			value = CGNExpression::run(context, var);
+			if (!value) {
+				return {};
+			} else if (value.stype()->isFunction() || value.stype()->isDestructable()) {
+				context.addError("variable " + varTok->str + " can not be captured by value", varTok);
+				return {};
+			}
+			memberType = value.stype();
+		}
+		values.push_back(value);
+		members.push_back(make_pair(varTok->str, memberType));
+	}
+
+	auto clType = SUserType::createClass(context, name->str, {});
+	SUserType::setBody(context, clType, members);
+
+	// the lambda body becomes the class call function
+	auto lambdaCtx = CodeContext::newForLambda(context);
+	lambdaCtx.setThis(clType);
+	lambdaCtx.setClass(clType);
+	auto params = exp->getParams();
+	params->addFront(new NParameter(new NPointerType(new NUserType(new Token(clType->raw()))), new Token("this")));
+	Token callTok(*name, "call");
+	auto func = CreateFunction(lambdaCtx, &callTok, exp->getReturnType(), params, exp->getBody());
+	delete params->popFront();
+	if (!func)
+		return {};
+	clType->addFunction("call", func);
+
+	RValue closure(Inst::Alloca(context, clType, name->str), clType);
+	for (size_t i = 0; i < values.size(); i++) {
+		Token memberTok(*name, members[i].first);
+		auto member = Inst::LoadMemberVar(context, closure, name, &memberTok);
+		context.IB().CreateStore(values[i], member);
+	}
+	return Inst::Load(context, closure);
+}
+
 static const set<string> asgOps = {
 	"=", "*=", "/=", "%=", "+=", "-=",
 	"<<=", ">>=", "&=", "^=", "|=", "\?\?=",
@@ -218,10 +462,7 @@ bool Builder::SetupClassDestructor(CodeContext& context, NClassDestructor* stm,
 	for (auto item : *clType) {
 		// only looking for fields so first item will do
 		auto ty = item.second[0].second.stype();
-		if (!ty->isClass())
-			continue;
-		auto itemCl = static_cast<SClassType*>(ty);
-		if (!itemCl->getDestructor())
+		if (!ty->isDestructable())
 			continue;
 
 		if (!prototype)
@@ -440,6 +681,23 @@ SFunction Builder::getBuiltinFunc(CodeContext& context, const Token* source, Bui
 			return getFuncPrototype(context, &freeName, funcType, linkage, nullptr, false);
 		}
 		return static_cast<SFunction&>(syms[0]);
+	case BuiltinFuncType::FreeSized:
+	case BuiltinFuncType::FreeAlignedSized:
+	{
+		auto isAligned = builtin == BuiltinFuncType::FreeAlignedSized;
+		auto name = isAligned? "free_aligned_sized" : "free_sized";
+		syms = context.loadSymbol(name);
+		if (syms.empty()) {
+			auto i64 = SType::getInt(context, 64);
+			auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+			auto retType = SType::getVoid(context);
+			auto funcType = isAligned? SType::getFunction(context, retType, {bytePtr, i64, i64}) : SType::getFunction(context, retType, {bytePtr, i64});
+			Token freeName(*source, name);
+			auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+			return getFuncPrototype(context, &freeName, funcType, linkage, nullptr, false);
+		}
+		return static_cast<SFunction&>(syms[0]);
+	}
 	case BuiltinFuncType::Malloc:
 		syms = context.loadSymbol("malloc");
 		if (syms.empty()) {
@@ -451,6 +709,17 @@ SFunction Builder::getBuiltinFunc(CodeContext& context, const Token* source, Bui
 			return getFuncPrototype(context, &mallocName, funcType, linkage, nullptr, false);
 		}
 		return static_cast<SFunction&>(syms[0]);
+	case BuiltinFuncType::AlignedAlloc:
+		syms = context.loadSymbol("aligned_alloc");
+		if (syms.empty()) {
+			auto i64 = SType::getInt(context, 64);
+			auto retType = SType::getPointer(context, SType::getInt(context, 8));
+			auto funcType = SType::getFunction(context, retType, {i64, i64});
+			Token allocName(*source, "aligned_alloc");
+			auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+			return getFuncPrototype(context, &allocName, funcType, linkage, nullptr, false);
+		}
+		return static_cast<SFunction&>(syms[0]);
 	case BuiltinFuncType::Printf:
 		syms = context.loadSymbol("printf");
 		if (syms.empty()) {
@@ -467,9 +736,829 @@ SFunction Builder::getBuiltinFunc(CodeContext& context, const Token* source, Bui
 			return function;
 		}
 		return static_cast<SFunction&>(syms[0]);
+	case BuiltinFuncType::Strlen:
+		syms = context.loadSymbol("strlen");
+		if (syms.empty()) {
+			auto i64 = SType::getInt(context, 64);
+			auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+			auto funcType = SType::getFunction(context, i64, {bytePtr});
+			Token strlenName(*source, "strlen");
+			auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+			return getFuncPrototype(context, &strlenName, funcType, linkage, nullptr, false);
+		}
+		return static_cast<SFunction&>(syms[0]);
+	case BuiltinFuncType::Memcmp:
+		syms = context.loadSymbol("memcmp");
+		if (syms.empty()) {
+			auto i32 = SType::getInt(context, 32);
+			auto i64 = SType::getInt(context, 64);
+			auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+			auto funcType = SType::getFunction(context, i32, {bytePtr, bytePtr, i64});
+			Token memcmpName(*source, "memcmp");
+			auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+			return getFuncPrototype(context, &memcmpName, funcType, linkage, nullptr, false);
+		}
+		return static_cast<SFunction&>(syms[0]);
+	case BuiltinFuncType::ParallelFor:
+	case BuiltinFuncType::Spawn:
+	case BuiltinFuncType::Sync:
+	{
+		// the task runtime is linked in like libc
+		auto name = builtin == BuiltinFuncType::ParallelFor? "__saphyr_parallel_for" : builtin == BuiltinFuncType::Spawn? "__saphyr_spawn" : "__saphyr_sync";
+		syms = context.loadSymbol(name);
+		if (syms.empty()) {
+			auto i64 = SType::getInt(context, 64);
+			auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+			auto retType = SType::getVoid(context);
+			SFunctionType* funcType;
+			if (builtin == BuiltinFuncType::ParallelFor) {
+				auto chunkFunc = SType::getPointer(context, SType::getFunction(context, retType, {bytePtr, i64, i64}));
+				funcType = SType::getFunction(context, retType, {chunkFunc, bytePtr, i64, i64});
+			} else if (builtin == BuiltinFuncType::Spawn) {
+				auto taskFunc = SType::getPointer(context, SType::getFunction(context, retType, {bytePtr}));
+				funcType = SType::getFunction(context, retType, {taskFunc, bytePtr});
+			} else {
+				funcType = SType::getFunction(context, retType, {});
+			}
+			Token funcName(*source, name);
+			auto linkage = GlobalValue::LinkageTypes::ExternalLinkage;
+			return getFuncPrototype(context, &funcName, funcType, linkage, nullptr, false);
+		}
+		return static_cast<SFunction&>(syms[0]);
+	}
+	default:
+		return {};
+	}
+}
+
+static const map<string, BuiltinCallType> builtinCalls = {
+	{"reduce_add", BuiltinCallType::ReduceAdd},
+	{"reduce_mul", BuiltinCallType::ReduceMul},
+	{"reduce_min", BuiltinCallType::ReduceMin},
+	{"reduce_max", BuiltinCallType::ReduceMax},
+	{"reduce_and", BuiltinCallType::ReduceAnd},
+	{"reduce_or", BuiltinCallType::ReduceOr},
+	{"reduce_xor", BuiltinCallType::ReduceXor},
+	{"shuffle", BuiltinCallType::Shuffle},
+	{"select", BuiltinCallType::Select},
+	{"masked_load", BuiltinCallType::MaskedLoad},
+	{"masked_store", BuiltinCallType::MaskedStore},
+	{"gather", BuiltinCallType::Gather},
+	{"scatter", BuiltinCallType::Scatter},
+	{"min", BuiltinCallType::Min},
+	{"max", BuiltinCallType::Max},
+	{"fma", BuiltinCallType::Fma},
+	{"sqrt", BuiltinCallType::Sqrt},
+	{"expect", BuiltinCallType::Expect},
+	{"atomic_load", BuiltinCallType::AtomicLoad},
+	{"atomic_store", BuiltinCallType::AtomicStore},
+	{"atomic_exchange", BuiltinCallType::AtomicExchange},
+	{"atomic_compare_exchange", BuiltinCallType::AtomicCompareExchange},
+	{"atomic_fetch_add", BuiltinCallType::AtomicFetchAdd},
+	{"atomic_fetch_sub", BuiltinCallType::AtomicFetchSub},
+	{"atomic_fetch_and", BuiltinCallType::AtomicFetchAnd},
+	{"atomic_fetch_or", BuiltinCallType::AtomicFetchOr},
+	{"atomic_fetch_xor", BuiltinCallType::AtomicFetchXor},
+	{"fence", BuiltinCallType::Fence},
+	{"spawn", BuiltinCallType::Spawn},
+	{"sync", BuiltinCallType::Sync},
+	{"resume", BuiltinCallType::Resume},
+	{"done", BuiltinCallType::Done},
+	{"destroy", BuiltinCallType::Destroy},
+	{"memcpy", BuiltinCallType::MemCopy},
+	{"memmove", BuiltinCallType::MemMove},
+	{"memset", BuiltinCallType::MemSet},
+	{"prefetch", BuiltinCallType::Prefetch},
+	{"nontemporal_load", BuiltinCallType::NonTemporalLoad},
+	{"nontemporal_store", BuiltinCallType::NonTemporalStore}
+};
+
+static const map<string, AtomicOrdering> atomicOrders = {
+	{"relaxed", AtomicOrdering::Monotonic},
+	{"acquire", AtomicOrdering::Acquire},
+	{"release", AtomicOrdering::Release},
+	{"acq_rel", AtomicOrdering::AcquireRelease},
+	{"seq_cst", AtomicOrdering::SequentiallyConsistent}
+};
+
+#if LLVM_VERSION_MAJOR >= 11
+	#define LL_ALIGN(x) Align(x)
+#else
+	#define LL_ALIGN(x) (x)
+#endif
+
+bool Builder::isBuiltinCall(const string& name)
+{
+	return builtinCalls.find(name) != builtinCalls.end();
+}
+
+RValue Builder::CallBuiltin(CodeContext& context, NFunctionCall* exp)
+{
+	auto name = exp->getName();
+	auto type = builtinCalls.at(name->str);
+
+	size_t minArgs, maxArgs;
+	switch (type) {
+	case BuiltinCallType::Shuffle:
+		minArgs = 2;
+		maxArgs = SIZE_MAX;
+		break;
+	case BuiltinCallType::MaskedLoad:
+		minArgs = 2;
+		maxArgs = 3;
+		break;
+	case BuiltinCallType::Gather:
+		minArgs = 3;
+		maxArgs = 4;
+		break;
+	case BuiltinCallType::Scatter:
+		minArgs = maxArgs = 4;
+		break;
+	case BuiltinCallType::Select:
+	case BuiltinCallType::MaskedStore:
+	case BuiltinCallType::Fma:
+	case BuiltinCallType::MemCopy:
+	case BuiltinCallType::MemMove:
+	case BuiltinCallType::MemSet:
+		minArgs = maxArgs = 3;
+		break;
+	case BuiltinCallType::Min:
+	case BuiltinCallType::Max:
+	case BuiltinCallType::Expect:
+	case BuiltinCallType::NonTemporalStore:
+		minArgs = maxArgs = 2;
+		break;
+	case BuiltinCallType::Prefetch:
+		minArgs = 1;
+		maxArgs = 3;
+		break;
+	case BuiltinCallType::Fence:
+		minArgs = 0;
+		maxArgs = 1;
+		break;
+	case BuiltinCallType::Spawn:
+		minArgs = 1;
+		maxArgs = SIZE_MAX;
+		break;
+	case BuiltinCallType::Sync:
+		minArgs = maxArgs = 0;
+		break;
+	case BuiltinCallType::AtomicLoad:
+		minArgs = 1;
+		maxArgs = 2;
+		break;
+	case BuiltinCallType::AtomicCompareExchange:
+		minArgs = 3;
+		maxArgs = 4;
+		break;
+	case BuiltinCallType::AtomicStore:
+	case BuiltinCallType::AtomicExchange:
+	case BuiltinCallType::AtomicFetchAdd:
+	case BuiltinCallType::AtomicFetchSub:
+	case BuiltinCallType::AtomicFetchAnd:
+	case BuiltinCallType::AtomicFetchOr:
+	case BuiltinCallType::AtomicFetchXor:
+		minArgs = 2;
+		maxArgs = 3;
+		break;
+	default:
+		minArgs = maxArgs = 1;
+		break;
+	}
+
+	// the optional memory ordering of atomics is a string literal, not a value argument
+	auto isAtomic = type >= BuiltinCallType::AtomicLoad && type <= BuiltinCallType::Fence;
+	auto argList = exp->getArguments();
+	NExpressionList valueArgs(false);
+	auto order = AtomicOrdering::SequentiallyConsistent;
+	if (isAtomic && argList->size() == maxArgs) {
+		if (!getAtomicOrder(context, name, argList->back(), order))
+			return {};
+		for (size_t i = 0; i + 1 < argList->size(); i++)
+			valueArgs.add(argList->at(i));
+		argList = &valueArgs;
+		minArgs = maxArgs = maxArgs - 1;
+	}
+
+	auto args = CGNExpression::collect(context, argList);
+	auto argCount = args->size();
+	if (argCount < minArgs || argCount > maxArgs) {
+		string required = minArgs == maxArgs? to_string(minArgs) : maxArgs == SIZE_MAX? "at least " + to_string(minArgs) : to_string(minArgs) + " or " + to_string(maxArgs);
+		context.addError("argument count for " + name->str + " function invalid, "
+			+ to_string(argCount) + " arguments given, but " + required + " required.", name);
+		return {};
+	}
+	for (auto& arg : *args) {
+		if (!arg)
+			return {};
+	}
+
+	switch (type) {
+	case BuiltinCallType::ReduceAdd:
+	case BuiltinCallType::ReduceMul:
+	case BuiltinCallType::ReduceMin:
+	case BuiltinCallType::ReduceMax:
+	case BuiltinCallType::ReduceAnd:
+	case BuiltinCallType::ReduceOr:
+	case BuiltinCallType::ReduceXor:
+		return CallVecReduce(context, type, name, *args);
+	case BuiltinCallType::Shuffle:
+	case BuiltinCallType::Select:
+		return CallVecShuffle(context, type, name, *args);
+	case BuiltinCallType::MaskedLoad:
+	case BuiltinCallType::MaskedStore:
+	case BuiltinCallType::Gather:
+	case BuiltinCallType::Scatter:
+		return CallVecMemory(context, type, name, *args);
+	case BuiltinCallType::Expect:
+		return CallExpect(context, name, *args);
+	case BuiltinCallType::MemCopy:
+	case BuiltinCallType::MemMove:
+	case BuiltinCallType::MemSet:
+		return CallMemIntrinsic(context, type, name, *args);
+	case BuiltinCallType::Prefetch:
+		return CallPrefetch(context, name, *args);
+	case BuiltinCallType::NonTemporalLoad:
+	case BuiltinCallType::NonTemporalStore:
+		return CallNonTemporal(context, type, name, *args);
+	case BuiltinCallType::AtomicLoad:
+	case BuiltinCallType::AtomicStore:
+	case BuiltinCallType::AtomicExchange:
+	case BuiltinCallType::AtomicCompareExchange:
+	case BuiltinCallType::AtomicFetchAdd:
+	case BuiltinCallType::AtomicFetchSub:
+	case BuiltinCallType::AtomicFetchAnd:
+	case BuiltinCallType::AtomicFetchOr:
+	case BuiltinCallType::AtomicFetchXor:
+	case BuiltinCallType::Fence:
+		return CallAtomic(context, type, name, *args, order);
+	case BuiltinCallType::Spawn:
+		return CallSpawn(context, name, *args);
+	case BuiltinCallType::Sync:
+	{
+		auto func = getBuiltinFunc(context, name, BuiltinFuncType::Sync);
+		return RValue(context.IB().CreateCall(func.funcType(), func.value()), SType::getVoid(context));
+	}
+	case BuiltinCallType::Resume:
+	case BuiltinCallType::Done:
+	case BuiltinCallType::Destroy:
+		return CallCoroutine(context, type, name, *args);
+	default:
+		return CallMathFunc(context, type, name, *args);
+	}
+}
+
+SType* Builder::getVecArg(CodeContext& context, Token* name, RValue& arg)
+{
+	auto type = arg.stype();
+	if (!type->isVec()) {
+		context.addError(name->str + " requires vec type argument", name);
+		return nullptr;
+	}
+	return type;
+}
+
+bool Builder::castMaskArg(CodeContext& context, Token* name, RValue& mask, SType* vecType)
+{
+	if (!mask.stype()->isVec()) {
+		context.addError(name->str + " mask must be vec type", name);
+		return true;
+	}
+	auto maskType = SType::getVec(context, SType::getBool(context), vecType->size());
+	return Inst::CastTo(context, name, mask, maskType);
+}
+
+RValue Builder::CallVecReduce(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto vecType = getVecArg(context, name, args[0]);
+	if (!vecType)
+		return {};
+	auto eleType = vecType->subType();
+	if (!eleType->isNumeric()) {
+		context.addError(name->str + " requires vec of numeric type", name);
+		return {};
+	}
+
+	auto& IB = context.IB();
+	Value* ret;
+	if (eleType->isFloating()) {
+		switch (type) {
+		case BuiltinCallType::ReduceAdd:
+			ret = IB.CreateFAddReduce(ConstantFP::getNegativeZero(*eleType), args[0]);
+			break;
+		case BuiltinCallType::ReduceMul:
+			ret = IB.CreateFMulReduce(ConstantFP::get(*eleType, 1.0), args[0]);
+			break;
+#if LLVM_VERSION_MAJOR >= 12
+		case BuiltinCallType::ReduceMin:
+			return RValue(IB.CreateFPMinReduce(args[0]), eleType);
+		case BuiltinCallType::ReduceMax:
+			return RValue(IB.CreateFPMaxReduce(args[0]), eleType);
+#else
+		case BuiltinCallType::ReduceMin:
+			return RValue(IB.CreateFPMinReduce(args[0], false), eleType);
+		case BuiltinCallType::ReduceMax:
+			return RValue(IB.CreateFPMaxReduce(args[0], false), eleType);
+#endif
+		default:
+			context.addError(name->str + " requires vec of integer type", name);
+			return {};
+		}
+		// allow the reduction to be done as a tree instead of in order
+		cast<Instruction>(ret)->setHasAllowReassoc(true);
+		return RValue(ret, eleType);
+	}
+
+	switch (type) {
+	case BuiltinCallType::ReduceAdd:
+		ret = IB.CreateAddReduce(args[0]);
+		break;
+	case BuiltinCallType::ReduceMul:
+		ret = IB.CreateMulReduce(args[0]);
+		break;
+	case BuiltinCallType::ReduceMin:
+		ret = IB.CreateIntMinReduce(args[0], !eleType->isUnsigned());
+		break;
+	case BuiltinCallType::ReduceMax:
+		ret = IB.CreateIntMaxReduce(args[0], !eleType->isUnsigned());
+		break;
+	case BuiltinCallType::ReduceAnd:
+		ret = IB.CreateAndReduce(args[0]);
+		break;
+	case BuiltinCallType::ReduceOr:
+		ret = IB.CreateOrReduce(args[0]);
+		break;
+	default:
+		ret = IB.CreateXorReduce(args[0]);
+		break;
+	}
+	return RValue(ret, eleType);
+}
+
+RValue Builder::CallVecShuffle(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto& IB = context.IB();
+
+	if (type == BuiltinCallType::Select) {
+		auto vecType = args[1].stype()->isVec()? args[1].stype() : args[2].stype();
+		if (!vecType->isVec()) {
+			context.addError(name->str + " requires vec type argument", name);
+			return {};
+		} else if (castMaskArg(context, name, args[0], vecType) || Inst::CastTo(context, name, args[1], vecType) || Inst::CastTo(context, name, args[2], vecType)) {
+			return {};
+		}
+		return RValue(IB.CreateSelect(args[0], args[1], args[2]), vecType);
+	}
+
+	auto vecType = getVecArg(context, name, args[0]);
+	if (!vecType)
+		return {};
+
+	// the second vector is optional, indexes then only select from the first
+	size_t start = 1;
+	Value* rhs = UndefValue::get(*vecType);
+	if (args[1].stype()->isVec()) {
+		if (Inst::CastTo(context, name, args[1], vecType))
+			return {};
+		rhs = args[1];
+		start = 2;
+	}
+	if (start == args.size()) {
+		context.addError(name->str + " requires at least one index", name);
+		return {};
+	}
+
+	int64_t limit = vecType->size() * start;
+	vector<Constant*> idxs;
+	for (auto i = start; i < args.size(); i++) {
+		auto idx = dyn_cast<ConstantInt>(args[i].value());
+		if (!idx) {
+			context.addError(name->str + " index must be a constant integer", name);
+			return {};
+		}
+		auto idxVal = idx->getSExtValue();
+		if (idxVal < 0 || idxVal >= limit) {
+			context.addError(name->str + " index " + to_string(idxVal) + " out of range", name);
+			return {};
+		}
+		idxs.push_back(IB.getInt32(idxVal));
+	}
+
+	auto retType = SType::getVec(context, vecType->subType(), idxs.size());
+	return RValue(IB.CreateShuffleVector(args[0], rhs, ConstantVector::get(idxs)), retType);
+}
+
+RValue Builder::CallVecMemory(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto& IB = context.IB();
+	auto ptrType = args[0].stype();
+
+	if (type == BuiltinCallType::MaskedLoad || type == BuiltinCallType::MaskedStore) {
+		if (!ptrType->isPointer() || !ptrType->subType()->isVec()) {
+			context.addError(name->str + " requires pointer to vec type", name);
+			return {};
+		}
+		auto vecType = ptrType->subType();
+		auto align = SType::allocAlign(context, vecType->subType());
+
+		if (type == BuiltinCallType::MaskedStore) {
+			if (Inst::CastTo(context, name, args[1], vecType) || castMaskArg(context, name, args[2], vecType))
+				return {};
+			auto call = IB.CreateMaskedStore(args[1], args[0], LL_ALIGN(align), args[2]);
+			return RValue(call, SType::getVoid(context));
+		}
+
+		auto passThru = args.size() > 2? args[2] : RValue::getZero(context, vecType);
+		if (castMaskArg(context, name, args[1], vecType) || Inst::CastTo(context, name, passThru, vecType))
+			return {};
+#if LLVM_VERSION_MAJOR >= 13
+		auto call = IB.CreateMaskedLoad(*vecType, args[0], LL_ALIGN(align), args[1], passThru);
+#else
+		auto call = IB.CreateMaskedLoad(args[0], LL_ALIGN(align), args[1], passThru);
+#endif
+		return RValue(call, vecType);
+	}
+
+	if (!ptrType->isPointer() || !(ptrType->subType()->isNumeric() || ptrType->subType()->isPointer())) {
+		context.addError(name->str + " requires pointer to numeric or pointer type", name);
+		return {};
+	}
+	auto idxType = args[1].stype();
+	if (!idxType->isVec() || !idxType->subType()->isInteger()) {
+		context.addError(name->str + " index must be vec of integer type", name);
+		return {};
+	}
+	auto eleType = ptrType->subType();
+	auto vecType = SType::getVec(context, eleType, idxType->size());
+	auto align = SType::allocAlign(context, eleType);
+	auto ptrs = IB.CreateGEP(*eleType, args[0], args[1]);
+
+	if (type == BuiltinCallType::Scatter) {
+		if (Inst::CastTo(context, name, args[2], vecType) || castMaskArg(context, name, args[3], vecType))
+			return {};
+		auto call = IB.CreateMaskedScatter(args[2], ptrs, LL_ALIGN(align), args[3]);
+		return RValue(call, SType::getVoid(context));
+	}
+
+	auto passThru = args.size() > 3? args[3] : RValue::getZero(context, vecType);
+	if (castMaskArg(context, name, args[2], vecType) || Inst::CastTo(context, name, passThru, vecType))
+		return {};
+#if LLVM_VERSION_MAJOR >= 13
+	auto call = IB.CreateMaskedGather(*vecType, ptrs, LL_ALIGN(align), args[2], passThru);
+#else
+	auto call = IB.CreateMaskedGather(ptrs, LL_ALIGN(align), args[2], passThru);
+#endif
+	return RValue(call, vecType);
+}
+
+RValue Builder::CallMathFunc(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	SType* retType = nullptr;
+	for (auto& arg : args) {
+		auto argType = arg.stype();
+		if (!argType->getScalar()->isNumeric()) {
+			context.addError(name->str + " requires numeric or vec type argument", name);
+			return {};
+		}
+		retType = retType? SType::numericConv(context, name, retType, argType, false) : argType;
+	}
+
+	auto isFloating = retType->getScalar()->isFloating();
+	if (!isFloating && (type == BuiltinCallType::Fma || type == BuiltinCallType::Sqrt)) {
+		context.addError(name->str + " requires floating point argument", name);
+		return {};
+	}
+	for (auto& arg : args) {
+		if (Inst::CastTo(context, name, arg, retType))
+			return {};
+	}
+
+	auto& IB = context.IB();
+	if (type == BuiltinCallType::Min || type == BuiltinCallType::Max) {
+		auto isMin = type == BuiltinCallType::Min;
+		if (isFloating) {
+			auto ret = isMin? IB.CreateMinNum(args[0], args[1]) : IB.CreateMaxNum(args[0], args[1]);
+			return RValue(ret, retType);
+		}
+		auto isUnsigned = retType->getScalar()->isUnsigned();
+		auto pred = isMin? (isUnsigned? CmpInst::ICMP_ULT : CmpInst::ICMP_SLT) : (isUnsigned? CmpInst::ICMP_UGT : CmpInst::ICMP_SGT);
+		auto cmp = IB.CreateICmp(pred, args[0], args[1]);
+		return RValue(IB.CreateSelect(cmp, args[0], args[1]), retType);
+	}
+
+	auto id = type == BuiltinCallType::Fma? Intrinsic::fma : Intrinsic::sqrt;
+	auto func = Intrinsic::getDeclaration(context.getModule(), id, {retType->type()});
+	vector<Value*> values;
+	transform(args.begin(), args.end(), back_inserter(values), [](auto i){ return i.value(); });
+	return RValue(IB.CreateCall(func->getFunctionType(), func, values), retType);
+}
+
+RValue Builder::CallExpect(CodeContext& context, Token* name, VecRValue& args)
+{
+	auto condType = args[0].stype();
+	if (!condType->isInteger()) {
+		context.addError(name->str + " requires int or bool type argument", name);
+		return {};
+	} else if (!isa<ConstantInt>(args[1].value())) {
+		context.addError(name->str + " expected value must be a constant int", name);
+		return {};
+	} else if (Inst::CastTo(context, name, args[1], condType)) {
+		return {};
+	}
+
+	auto func = Intrinsic::getDeclaration(context.getModule(), Intrinsic::expect, {condType->type()});
+	return RValue(context.IB().CreateCall(func->getFunctionType(), func, {args[0].value(), args[1].value()}), condType);
+}
+
+RValue Builder::CallMemIntrinsic(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto isSet = type == BuiltinCallType::MemSet;
+	auto destType = args[0].stype();
+	auto srcType = args[1].stype();
+	if (!destType->isPointer() || (!isSet && !srcType->isPointer())) {
+		context.addError(name->str + " requires pointer type argument", name);
+		return {};
+	} else if (destType->subType()->isConst()) {
+		context.addError(name->str + " can't modify const type: " + destType->subType()->str(context), name);
+		return {};
+	}
+
+	// use the alignment of the pointed to types so the copy can use wider moves
+	auto typeAlign = [&](SType* type) -> uint64_t {
+		return type->isUnsized() || type->isFunction()? 1 : SType::allocAlign(context, type);
+	};
+	auto align = typeAlign(destType->subType());
+	if (!isSet)
+		align = min(align, typeAlign(srcType->subType()));
+
+	auto voidPtr = SType::getPointer(context, SType::getVoid(context));
+	auto valType = isSet? SType::getInt(context, 8, true) : voidPtr;
+	if (Inst::CastTo(context, name, args[0], voidPtr) || Inst::CastTo(context, name, args[1], valType)
+			|| Inst::CastTo(context, name, args[2], SType::getInt(context, 64, true)))
+		return {};
+
+	if (isSet)
+		Inst::MemSet(context, args[0], args[1], args[2], align);
+	else
+		Inst::MemCopy(context, args[0], args[1], args[2], align, type == BuiltinCallType::MemMove);
+	return RValue(args[0].value(), voidPtr);
+}
+
+RValue Builder::CallPrefetch(CodeContext& context, Token* name, VecRValue& args)
+{
+	if (!args[0].stype()->isPointer()) {
+		context.addError(name->str + " requires pointer type argument", name);
+		return {};
+	}
+
+	// rw is 0 for read or 1 for write, locality is from 0 (no reuse)
+	// to 3 (keep in all cache levels)
+	int64_t hints[] = {0, 3};
+	for (size_t i = 1; i < args.size(); i++) {
+		auto hint = dyn_cast<ConstantInt>(args[i].value());
+		int64_t maxVal = i == 1? 1 : 3;
+		if (!hint || hint->getSExtValue() < 0 || hint->getSExtValue() > maxVal) {
+			context.addError(name->str + (i == 1? " rw" : " locality") + " must be a constant int from 0 to " + to_string(maxVal), name);
+			return {};
+		}
+		hints[i - 1] = hint->getSExtValue();
+	}
+
+	auto voidPtr = SType::getPointer(context, SType::getVoid(context));
+	if (Inst::CastTo(context, name, args[0], voidPtr))
+		return {};
+
+	auto& IB = context.IB();
+#if LLVM_VERSION_MAJOR >= 10
+	auto func = Intrinsic::getDeclaration(context.getModule(), Intrinsic::prefetch, {voidPtr->type()});
+#else
+	auto func = Intrinsic::getDeclaration(context.getModule(), Intrinsic::prefetch);
+#endif
+	// the last argument selects the data cache
+	auto call = IB.CreateCall(func->getFunctionType(), func, {args[0].value(), IB.getInt32(hints[0]), IB.getInt32(hints[1]), IB.getInt32(1)});
+	return RValue(call, SType::getVoid(context));
+}
+
+RValue Builder::CallNonTemporal(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto ptrType = args[0].stype();
+	auto eleType = ptrType->isPointer()? ptrType->subType() : nullptr;
+	if (!eleType || !(eleType->isNumeric() || eleType->isVec() || eleType->isPointer())) {
+		context.addError(name->str + " requires pointer to numeric, vec or pointer type", name);
+		return {};
+	}
+
+	auto& IB = context.IB();
+	auto align = SType::allocAlign(context, eleType);
+	// the value isn't expected to be reused, so it shouldn't be kept in the cache
+	auto hint = MDNode::get(context, ConstantAsMetadata::get(IB.getInt32(1)));
+	if (type == BuiltinCallType::NonTemporalLoad) {
+		auto load = IB.CreateAlignedLoad(*eleType, args[0], LL_ALIGN(align));
+		load->setMetadata(LLVMContext::MD_nontemporal, hint);
+		return RValue(load, eleType);
+	} else if (eleType->isConst()) {
+		context.addError(name->str + " can't modify const type: " + eleType->str(context), name);
+		return {};
+	} else if (Inst::CastTo(context, name, args[1], eleType)) {
+		return {};
+	}
+	auto store = IB.CreateAlignedStore(args[1], args[0], LL_ALIGN(align));
+	store->setMetadata(LLVMContext::MD_nontemporal, hint);
+	return RValue(store, SType::getVoid(context));
+}
+
+bool Builder::getAtomicOrder(CodeContext& context, Token* name, NExpression* exp, AtomicOrdering& order)
+{
+	if (exp->id() == NodeId::NStringLiteral) {
+		auto item = atomicOrders.find(static_cast<NStringLiteral*>(exp)->getStr());
+		if (item != atomicOrders.end()) {
+			order = item->second;
+			return true;
+		}
+	}
+	context.addError(name->str + " memory order must be one of: \"relaxed\", \"acquire\", \"release\", \"acq_rel\", \"seq_cst\"", *exp);
+	return false;
+}
+
+RValue Builder::CallAtomic(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args, AtomicOrdering order)
+{
+	auto& IB = context.IB();
+	if (type == BuiltinCallType::Fence) {
+		if (order == AtomicOrdering::Monotonic) {
+			context.addError(name->str + " can't use relaxed memory order", name);
+			return {};
+		}
+		return RValue(IB.CreateFence(order), SType::getVoid(context));
+	}
+
+	auto ptrType = args[0].stype();
+	auto eleType = ptrType->isPointer()? ptrType->subType() : nullptr;
+	auto isCmpXchg = type == BuiltinCallType::AtomicCompareExchange;
+	if (type == BuiltinCallType::AtomicLoad || type == BuiltinCallType::AtomicStore) {
+		if (!eleType || eleType->isBool() || !(eleType->isNumeric() || eleType->isPointer())) {
+			context.addError(name->str + " requires pointer to numeric or pointer type", name);
+			return {};
+		}
+	} else if (!eleType || eleType->isBool() || !(eleType->isInteger() || (isCmpXchg && eleType->isPointer()))) {
+		context.addError(name->str + (isCmpXchg? " requires pointer to int or pointer type" : " requires pointer to int type"), name);
+		return {};
+	}
+
+	// atomics must be naturally aligned or they're lowered to library calls
+	auto align = SType::allocSize(context, eleType);
+	if (type == BuiltinCallType::AtomicLoad) {
+		if (order == AtomicOrdering::Release || order == AtomicOrdering::AcquireRelease) {
+			context.addError(name->str + " can't use release memory order", name);
+			return {};
+		}
+		auto load = IB.CreateAlignedLoad(*eleType, args[0], LL_ALIGN(align));
+		load->setAtomic(order);
+		return RValue(load, eleType);
+	} else if (eleType->isConst()) {
+		context.addError(name->str + " can't modify const type: " + eleType->str(context), name);
+		return {};
+	}
+
+	for (size_t i = 1; i < args.size(); i++) {
+		if (Inst::CastTo(context, name, args[i], eleType))
+			return {};
+	}
+
+	if (type == BuiltinCallType::AtomicStore) {
+		if (order == AtomicOrdering::Acquire || order == AtomicOrdering::AcquireRelease) {
+			context.addError(name->str + " can't use acquire memory order", name);
+			return {};
+		}
+		auto store = IB.CreateAlignedStore(args[1], args[0], LL_ALIGN(align));
+		store->setAtomic(order);
+		return RValue(store, SType::getVoid(context));
+	} else if (isCmpXchg) {
+		auto failOrder = AtomicCmpXchgInst::getStrongestFailureOrdering(order);
+#if LLVM_VERSION_MAJOR >= 13
+		auto cmpXchg = IB.CreateAtomicCmpXchg(args[0], args[1], args[2], MaybeAlign(align), order, failOrder);
+#else
+		auto cmpXchg = IB.CreateAtomicCmpXchg(args[0], args[1], args[2], order, failOrder);
+#endif
+		return RValue(IB.CreateExtractValue(cmpXchg, 0), eleType);
+	}
+
+	AtomicRMWInst::BinOp op;
+	switch (type) {
+	case BuiltinCallType::AtomicFetchAdd:
+		op = AtomicRMWInst::Add;
+		break;
+	case BuiltinCallType::AtomicFetchSub:
+		op = AtomicRMWInst::Sub;
+		break;
+	case BuiltinCallType::AtomicFetchAnd:
+		op = AtomicRMWInst::And;
+		break;
+	case BuiltinCallType::AtomicFetchOr:
+		op = AtomicRMWInst::Or;
+		break;
+	case BuiltinCallType::AtomicFetchXor:
+		op = AtomicRMWInst::Xor;
+		break;
 	default:
+		op = AtomicRMWInst::Xchg;
+		break;
+	}
+#if LLVM_VERSION_MAJOR >= 13
+	auto rmw = IB.CreateAtomicRMW(op, args[0], args[1], MaybeAlign(align), order);
+#else
+	auto rmw = IB.CreateAtomicRMW(op, args[0], args[1], order);
+#endif
+	return RValue(rmw, eleType);
+}
+
+RValue Builder::CallSpawn(CodeContext& context, Token* name, VecRValue& args)
+{
+	auto funcVal = args[0];
+	auto funcType = funcVal.stype()->isPointer()? funcVal.stype()->subType() : funcVal.stype();
+	if (!funcType->isFunction()) {
+		context.addError(name->str + " requires a function as the first argument", name);
+		return {};
+	}
+	auto sFuncType = static_cast<SFunctionType*>(funcType);
+	auto argCount = args.size() - 1;
+	if (argCount != sFuncType->numParams()) {
+		context.addError("argument count for spawned function invalid, " + to_string(argCount)
+			+ " arguments given, but " + to_string(sFuncType->numParams()) + " required.", name);
 		return {};
 	}
+
+	// the function and its arguments are copied to the heap for the task to use
+	vector<Type*> fields{funcVal.value()->getType()};
+	vector<Value*> values{funcVal.value()};
+	for (size_t i = 0; i < argCount; i++) {
+		auto paramType = sFuncType->getParam(i);
+		if (paramType->isDestructable()) {
+			context.addError(name->str + " arguments can't be destructable types", name);
+			return {};
+		} else if (Inst::CastTo(context, name, args[i + 1], paramType)) {
+			return {};
+		}
+		fields.push_back(args[i + 1].value()->getType());
+		values.push_back(args[i + 1].value());
+	}
+
+	LLVMContext& llvmContext = context;
+	auto module = context.getModule();
+	auto dataType = StructType::get(llvmContext, fields);
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+	auto taskType = SType::getFunction(context, SType::getVoid(context), {bytePtr});
+	auto taskName = context.currFunction().name().str() + "_spawn" + to_string(name->line) + to_string(name->col);
+	auto task = Function::Create(taskType->funcType(), GlobalValue::InternalLinkage, taskName, module);
+
+	// the task unpacks the arguments, calls the function and frees the data
+	IRBuilder<> builder(BasicBlock::Create(llvmContext, "", task));
+	auto taskArg = &*task->arg_begin();
+	auto taskData = builder.CreateBitCast(taskArg, dataType->getPointerTo());
+	auto callee = builder.CreateLoad(fields[0], builder.CreateStructGEP(dataType, taskData, 0));
+	vector<Value*> callArgs;
+	for (unsigned i = 1; i < fields.size(); i++)
+		callArgs.push_back(builder.CreateLoad(fields[i], builder.CreateStructGEP(dataType, taskData, i)));
+	builder.CreateCall(sFuncType->funcType(), callee, callArgs);
+	auto freeFunc = getBuiltinFunc(context, name, BuiltinFuncType::Free);
+	builder.CreateCall(freeFunc.funcType(), freeFunc.value(), {taskArg});
+	builder.CreateRetVoid();
+
+	auto& IB = context.IB();
+	uint64_t dataSize = module->getDataLayout().getTypeAllocSize(dataType);
+	auto mallocFunc = getBuiltinFunc(context, name, BuiltinFuncType::Malloc);
+	auto data = IB.CreateCall(mallocFunc.funcType(), mallocFunc.value(), {RValue::getNumVal(context, dataSize, 64).value()});
+	auto dataPtr = IB.CreateBitCast(data, dataType->getPointerTo());
+	for (unsigned i = 0; i < values.size(); i++)
+		IB.CreateStore(values[i], IB.CreateStructGEP(dataType, dataPtr, i));
+
+	auto spawnFunc = getBuiltinFunc(context, name, BuiltinFuncType::Spawn);
+	return RValue(IB.CreateCall(spawnFunc.funcType(), spawnFunc.value(), {task, data}), SType::getVoid(context));
+}
+
+RValue Builder::CallCoroutine(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args)
+{
+	auto promiseTy = args[0].stype();
+	if (!promiseTy->isAsync()) {
+		context.addError(name->str + " requires an async function result", name);
+		return {};
+	}
+
+	// recover the coroutine handle from the promise pointer
+	auto& IB = context.IB();
+	auto module = context.getModule();
+	auto align = SType::allocAlign(context, promiseTy->subType());
+	auto promise = IB.CreateBitCast(args[0], IB.getInt8PtrTy());
+	auto promiseFunc = Intrinsic::getDeclaration(module, Intrinsic::coro_promise);
+	auto handle = IB.CreateCall(promiseFunc, {promise, IB.getInt32(align), IB.getTrue()});
+
+	switch (type) {
+	case BuiltinCallType::Resume:
+		return RValue(IB.CreateCall(Intrinsic::getDeclaration(module, Intrinsic::coro_resume), {handle}), SType::getVoid(context));
+	case BuiltinCallType::Destroy:
+		return RValue(IB.CreateCall(Intrinsic::getDeclaration(module, Intrinsic::coro_destroy), {handle}), SType::getVoid(context));
+	default:
+		return RValue(IB.CreateCall(Intrinsic::getDeclaration(module, Intrinsic::coro_done), {handle}), SType::getBool(context));
+	}
 }
 
 void Builder::AddDebugPrint(CodeContext& context, Token* source, const string& msg, vector<Value*> args)
@@ -484,6 +1573,70 @@ void Builder::AddDebugPrint(CodeContext& context, Token* source, const string& m
 	context.IB().CreateCall(printf.funcValue()->getFunctionType(), printf.value(), args);
 }
 
+RValue Builder::getAllocator(CodeContext& context, NExpression* exp)
+{
+	if (!exp)
+		return context.getAllocator();
+
+	auto varPtr = dynamic_cast<NVariable*>(exp);
+	return varPtr? CGNVariable::run(context, varPtr) : Inst::StoreTemporary(context, exp);
+}
+
+RValue Builder::CallAllocator(CodeContext& context, RValue allocator, Token* token, const string& funcName, VecRValue& args)
+{
+	auto var = Inst::Deref(context, allocator, true);
+	if (!var.stype()->isClass()) {
+		context.addError("allocator requires class type, found " + var.stype()->str(context), token);
+		return {};
+	}
+
+	auto clType = static_cast<SClassType*>(var.stype());
+	auto sym = clType->getItem(funcName);
+	VecSFunc funcs;
+	auto isStatic = true;
+	if (sym) {
+		for (auto item : *sym) {
+			if (item.second.isFunction()) {
+				auto func = static_cast<SFunction&>(item.second);
+				isStatic &= func.isStatic();
+				funcs.push_back(func);
+			}
+		}
+	}
+	if (funcs.empty()) {
+		context.addError("allocator class " + clType->str(context) + " has no function " + funcName, token);
+		return {};
+	}
+
+	if (!isStatic)
+		args.insert(args.begin(), RValue(var.value(), SType::getPointer(context, clType)));
+	return Inst::CallFunction(context, funcs, token, args);
+}
+
+RValue Builder::getAllocSize(CodeContext& context, SType* type, RValue arrSize)
+{
+	auto int64Ty = SType::getInt(context, 64);
+	if (type->isArray() && arrSize && arrSize.stype()->isInteger()) {
+		auto elemSize = RValue::getNumVal(context, SType::allocSize(context, type->subType()), 64);
+		Inst::CastTo(context, nullptr, arrSize, int64Ty);
+		return RValue(context.IB().CreateMul(arrSize, elemSize), int64Ty);
+	}
+	// unsized arrays and void pointers have no known size
+	auto size = type->isUnsized()? 0 : SType::allocSize(context, type);
+	return RValue::getNumVal(context, size, 64);
+}
+
+void Builder::CallSizedFree(CodeContext& context, Token* token, RValue ptr, RValue size, uint64_t align)
+{
+	if (align > 16) {
+		auto func = getBuiltinFunc(context, token, BuiltinFuncType::FreeAlignedSized);
+		context.IB().CreateCall(func.funcType(), func.value(), {ptr.value(), RValue::getNumVal(context, align, 64).value(), size.value()});
+	} else {
+		auto func = getBuiltinFunc(context, token, BuiltinFuncType::FreeSized);
+		context.IB().CreateCall(func.funcType(), func.value(), {ptr.value(), size.value()});
+	}
+}
+
 bool Builder::addMembers(NStructDeclaration::CreateType ctype, NVariableDeclGroup* group, vector<pair<string, SType*> >& structVector, set<string>& memberNames, CodeContext& context)
 {
 	auto stype = CGNDataType::run(context, group->getType());
@@ -539,6 +1692,209 @@ void Builder::validateAttrList(CodeContext& context, NAttributeList* attrs)
 	}
 }
 
+uint64_t Builder::getAlignAttr(CodeContext& context, NAttributeList* attrs)
+{
+	auto attr = NAttributeList::find(attrs, "align");
+	if (!attr)
+		return 0;
+
+	auto val = NAttribute::find(attr, 0);
+	if (!val) {
+		context.addError("align attribute requires value", *attr);
+		return 0;
+	}
+
+	auto str = val->str();
+	auto isNum = !str.empty() && str.size() < 10 && all_of(str.begin(), str.end(), [](char c){ return isdigit(c); });
+	auto align = isNum? stoull(str) : 0;
+	if (!isPowerOf2_64(align)) {
+		context.addError("align attribute value must be a power of 2: " + str, *val);
+		return 0;
+	}
+	return align;
+}
+
+static const map<string, GlobalVariable::ThreadLocalMode> tlsModels = {
+	{"general_dynamic", GlobalVariable::GeneralDynamicTLSModel},
+	{"local_dynamic", GlobalVariable::LocalDynamicTLSModel},
+	{"initial_exec", GlobalVariable::InitialExecTLSModel},
+	{"local_exec", GlobalVariable::LocalExecTLSModel}
+};
+
+GlobalVariable::ThreadLocalMode Builder::getThreadLocalAttr(CodeContext& context, NAttributeList* attrs)
+{
+	auto attr = NAttributeList::find(attrs, "thread_local");
+	if (!attr)
+		return GlobalVariable::NotThreadLocal;
+
+	// the backend picks the fastest model it can for the relocation model
+	auto val = NAttribute::find(attr, 0);
+	if (!val)
+		return GlobalVariable::GeneralDynamicTLSModel;
+
+	auto model = tlsModels.find(val->str());
+	if (model == tlsModels.end()) {
+		context.addError("thread_local attribute value must be general_dynamic, local_dynamic, initial_exec or local_exec: " + val->str(), *val);
+		return GlobalVariable::NotThreadLocal;
+	}
+	return model->second;
+}
+
+bool Builder::getAtomicAttr(CodeContext& context, NAttributeList* attrs, SType* type, Token* name)
+{
+	auto attr = NAttributeList::find(attrs, "atomic");
+	if (!attr)
+		return false;
+
+	if (type->isBool() || !(type->isNumeric() || type->isPointer())) {
+		context.addError("atomic attribute requires numeric or pointer type: " + type->str(context), name);
+		return false;
+	}
+	return true;
+}
+
+RValue Builder::LoadAtomic(CodeContext& context, RValue var)
+{
+	VecRValue args;
+	args.push_back({var.value(), SType::getPointer(context, var.stype())});
+
+	Token name("atomic_load");
+	return CallAtomic(context, BuiltinCallType::AtomicLoad, &name, args, AtomicOrdering::SequentiallyConsistent);
+}
+
+static const map<int, BuiltinCallType> atomicUpdateOps = {
+	{'+', BuiltinCallType::AtomicFetchAdd},
+	{'-', BuiltinCallType::AtomicFetchSub},
+	{'&', BuiltinCallType::AtomicFetchAnd},
+	{'|', BuiltinCallType::AtomicFetchOr},
+	{'^', BuiltinCallType::AtomicFetchXor}
+};
+
+RValue Builder::AtomicUpdate(CodeContext& context, RValue var, int op, RValue value, Token* token, bool postfix)
+{
+	if (!value)
+		return {};
+
+	VecRValue args;
+	args.push_back({var.value(), SType::getPointer(context, var.stype())});
+	args.push_back(value);
+
+	auto order = AtomicOrdering::SequentiallyConsistent;
+	if (op == '=')
+		return CallAtomic(context, BuiltinCallType::AtomicStore, token, args, order)? args[1] : RValue();
+
+	auto item = atomicUpdateOps.find(op);
+	if (item == atomicUpdateOps.end()) {
+		context.addError("operator " + token->str + " not supported for atomic variable", token);
+		return {};
+	} else if (!var.stype()->isInteger()) {
+		context.addError("atomic variable only supports assignment for type: " + var.stype()->str(context), token);
+		return {};
+	}
+
+	// the read-modify-write returns the old value
+	auto oldVal = CallAtomic(context, item->second, token, args, order);
+	if (!oldVal || postfix)
+		return oldVal;
+	return Inst::BinaryOp(op, token, oldVal, args[1], context);
+}
+
+MDNode* Builder::getLoopMetadata(CodeContext& context, NAttributeList* attrs)
+{
+	if (!attrs)
+		return nullptr;
+	validateAttrList(context, attrs);
+
+	auto unroll = NAttributeList::find(attrs, "unroll");
+	auto nounroll = NAttributeList::find(attrs, "nounroll");
+	auto vectorize = NAttributeList::find(attrs, "vectorize");
+	auto novectorize = NAttributeList::find(attrs, "novectorize");
+	auto interleave = NAttributeList::find(attrs, "interleave");
+
+	if (unroll && nounroll) {
+		context.addError("unroll and nounroll attributes conflict", *nounroll);
+		return nullptr;
+	} else if (vectorize && novectorize) {
+		context.addError("vectorize and novectorize attributes conflict", *novectorize);
+		return nullptr;
+	} else if (interleave && !NAttribute::find(interleave, 0)) {
+		context.addError("interleave attribute requires value", *interleave);
+		return nullptr;
+	}
+
+	bool hasError = false;
+	auto getCount = [&](NAttribute* attr) -> uint64_t {
+		auto val = NAttribute::find(attr, 0);
+		if (!val)
+			return 0;
+		auto str = val->str();
+		auto isNum = !str.empty() && str.size() < 10 && all_of(str.begin(), str.end(), [](char c){ return isdigit(c); });
+		auto count = isNum? stoull(str) : 0;
+		if (!count) {
+			context.addError(attr->getName()->str + " attribute value must be a positive integer: " + str, *val);
+			hasError = true;
+		}
+		return count;
+	};
+
+	LLVMContext& llvmContext = context;
+	auto int32Ty = Type::getInt32Ty(llvmContext);
+	auto boolTy = Type::getInt1Ty(llvmContext);
+	vector<Metadata*> ops;
+	auto addOp = [&](const string& name, Type* type, uint64_t value) {
+		Metadata* op = MDString::get(llvmContext, name);
+		if (type)
+			ops.push_back(MDNode::get(llvmContext, {op, ConstantAsMetadata::get(ConstantInt::get(type, value))}));
+		else
+			ops.push_back(MDNode::get(llvmContext, op));
+	};
+
+	// first operand is reserved for the self reference
+	ops.push_back(nullptr);
+	if (unroll) {
+		auto count = getCount(unroll);
+		if (count)
+			addOp("llvm.loop.unroll.count", int32Ty, count);
+		else
+			addOp("llvm.loop.unroll.enable", nullptr, 0);
+	} else if (nounroll) {
+		addOp("llvm.loop.unroll.disable", nullptr, 0);
+	}
+	if (vectorize) {
+		auto width = getCount(vectorize);
+		if (width)
+			addOp("llvm.loop.vectorize.width", int32Ty, width);
+		addOp("llvm.loop.vectorize.enable", boolTy, 1);
+	} else if (novectorize) {
+		addOp("llvm.loop.vectorize.enable", boolTy, 0);
+	}
+	if (interleave) {
+		addOp("llvm.loop.interleave.count", int32Ty, getCount(interleave));
+	}
+
+	if (hasError || ops.size() == 1)
+		return nullptr;
+
+	auto loopID = MDNode::getDistinct(llvmContext, ops);
+	loopID->replaceOperandWith(0, loopID);
+	return loopID;
+}
+
+int Builder::getLikelyAttr(CodeContext& context, NAttributeList* attrs)
+{
+	if (!attrs)
+		return 0;
+	validateAttrList(context, attrs);
+
+	auto likely = NAttributeList::find(attrs, "likely");
+	auto unlikely = NAttributeList::find(attrs, "unlikely");
+	if (likely && unlikely) {
+		context.addError("likely and unlikely attributes conflict", *unlikely);
+		return 0;
+	}
+	return likely? 1 : unlikely? -1 : 0;
+}
+
 bool Builder::StoreTemplate(CodeContext& context, NTemplatedDeclaration* stm)
 {
 	if (!context.inTemplate()) {
@@ -554,12 +1910,147 @@ bool Builder::StoreTemplate(CodeContext& context, NTemplatedDeclaration* stm)
 	return false;
 }
 
-void Builder::CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list)
+bool Builder::StoreFuncTemplate(CodeContext& context, NFunctionDeclaration* stm)
+{
+	if (!stm->getTemplateParams())
+		return false;
+
+	auto name = stm->getName()->str;
+	if (context.getFuncTemplate(name) || !context.loadSymbolGlobal(name).empty())
+		context.addError("function with name " + name + " already declared", stm->getName());
+	else if (!stm->getBody())
+		context.addError("function template " + name + " requires a body", stm->getName());
+	else
+		context.storeFuncTemplate(name, stm);
+	return true;
+}
+
+void Builder::deduceTemplateArg(CodeContext& context, NDataType* param, SType* arg, NIdentifierList* names, VecSType& result)
+{
+	switch (param->id()) {
+	case NodeId::NUserType:
+	{
+		auto userType = static_cast<NUserType*>(param);
+		if (userType->getTemplateArgs())
+			return;
+		for (size_t i = 0; i < names->size(); i++) {
+			if (!result[i] && names->at(i)->str == userType->getName()->str)
+				result[i] = SType::getMutable(context, arg);
+		}
+		return;
+	}
+	case NodeId::NConstType:
+		deduceTemplateArg(context, static_cast<NConstType*>(param)->getType(), arg, names, result);
+		return;
+	case NodeId::NReferenceType:
+	case NodeId::NCopyReferenceType:
+		arg = arg->isReference()? arg->subType() : arg;
+		deduceTemplateArg(context, static_cast<NReferenceType*>(param)->getBaseType(), arg, names, result);
+		return;
+	case NodeId::NPointerType:
+		if (arg->isPointer())
+			deduceTemplateArg(context, static_cast<NPointerType*>(param)->getBaseType(), arg->subType(), names, result);
+		return;
+	case NodeId::NArrayType:
+	{
+		if (!arg->isArray())
+			return;
+		auto arrType = static_cast<NArrayType*>(param);
+		auto size = arrType->getSize();
+		if (size && size->id() == NodeId::NBaseVariable && arg->size()) {
+			auto sizeName = static_cast<NBaseVariable*>(size)->getName()->str;
+			for (size_t i = 0; i < names->size(); i++) {
+				if (!result[i] && names->at(i)->str == sizeName)
+					result[i] = SType::getConstValue(context, SType::getInt(context, 32), arg->size());
+			}
+		}
+		deduceTemplateArg(context, arrType->getBaseType(), arg->subType(), names, result);
+		return;
+	}
+	case NodeId::NSliceType:
+		if (arg->isSlice())
+			deduceTemplateArg(context, static_cast<NSliceType*>(param)->getBaseType(), arg->subType(), names, result);
+		return;
+	default:
+		return;
+	}
+}
+
+RValue Builder::CallFuncTemplate(CodeContext& context, NFunctionCall* exp, NFunctionDeclaration* decl)
+{
+	auto name = exp->getName();
+	auto params = decl->getTemplateParams();
+	VecSType templateArgs(params->size(), nullptr);
+
+	auto explicitArgs = exp->getTemplateArgs();
+	if (explicitArgs) {
+		if (explicitArgs->size() > params->size()) {
+			context.addError("number of template args doesn't match for " + name->str, name);
+			return {};
+		}
+		for (size_t i = 0; i < explicitArgs->size(); i++) {
+			templateArgs[i] = CGNDataType::runTemplateArg(context, explicitArgs->at(i));
+			if (!templateArgs[i])
+				return {};
+		}
+	}
+
+	auto args = CGNExpression::collect(context, exp->getArguments());
+	for (auto& arg : *args) {
+		if (!arg)
+			return {};
+	}
+
+	// template args that weren't given are deduced from the call arguments
+	auto funcParams = decl->getParams();
+	for (size_t i = 0; i < funcParams->size() && i < args->size(); i++)
+		deduceTemplateArg(context, funcParams->at(i)->getType(), args->at(i).stype(), params, templateArgs);
+
+	vector<pair<string, SType*>> templateMappings;
+	for (size_t i = 0; i < params->size(); i++) {
+		if (!templateArgs[i]) {
+			context.addError("unable to deduce template argument " + params->at(i)->str + " for " + name->str, name);
+			return {};
+		}
+		templateMappings.push_back({params->at(i)->str, templateArgs[i]});
+	}
+
+	// instances are cached by name and template args
+	Token instName(*decl->getName(), SUserType::raw(name->str, templateArgs));
+	VecSFunc funcs;
+	for (auto sym : context.loadSymbolGlobal(instName.str)) {
+		if (sym.isFunction())
+			funcs.push_back(static_cast<SFunction&>(sym));
+	}
+	if (funcs.empty()) {
+		auto errorCount = context.errorCount();
+		auto templateCtx = CodeContext::newForTemplate(context, templateMappings);
+		uPtr<NFunctionDeclaration> instance(decl->copy());
+		auto func = CreateFunction(templateCtx, &instName, instance->getRType(), instance->getParams(), instance->getBody(), instance->getAttrs());
+		if (context.errorCount() > errorCount)
+			context.addError("errors when creating function: " + instName.str, name);
+		if (!func)
+			return {};
+		funcs.push_back(func);
+	}
+	return Inst::CallFunction(context, funcs, name, *args);
+}
+
+void Builder::CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list, NAttributeList* attrs)
 {
 	auto tArgs = context.getTemplateArgs();
 	if (isDeclared(context, name, tArgs))
 		return;
 
+	validateAttrList(context, attrs);
+	auto packed = NAttributeList::find(attrs, "packed") != nullptr;
+	auto align = getAlignAttr(context, attrs);
+	auto soa = NAttributeList::find(attrs, "soa");
+	if (soa && ctype != NStructDeclaration::CreateType::STRUCT) {
+		context.addError("soa attribute only valid for struct", *soa);
+		soa = nullptr;
+	}
+
 	auto structName = name->str;
 	vector<pair<string, SType*> > structVars;
 	set<string> memberNames;
@@ -586,7 +2077,7 @@ void Builder::CreateStruct(CodeContext& context, NStructDeclaration::CreateType
 
 	if (list) {
 		for_each(list->begin(), list->end(), [&](auto i){ return addMembers(ctype, i, structVars, memberNames, context); });
-		SUserType::setBody(context, userType, structVars);
+		SUserType::setBody(context, userType, structVars, packed, align, soa);
 	}
 
 	if (!isClass)
@@ -675,10 +2166,20 @@ void Builder::CreateAlias(CodeContext& context, NAliasDeclaration* stm)
 
 void CreateGlobalVar_Internal(CodeContext& context, NGlobalVariableDecl* stm, bool declaration)
 {
+	if (NAttributeList::find(stm->getAttrs(), "packed")) {
+		context.addError("packed attribute only valid for struct, union or class", stm->getName());
+		return;
+	}
+	auto align = Builder::getAlignAttr(context, stm->getAttrs());
+	auto tlsMode = Builder::getThreadLocalAttr(context, stm->getAttrs());
+
+	// initializers that don't fold to a constant are evaluated after all
+	// functions are generated, the variable starts out as undefined
 	auto initValue = CGNExpression::run(context, stm->getInitExp());
+	RValue evalValue;
 	if (initValue && !isa<Constant>(initValue.value())) {
-		context.addError("global variables only support constant value initializer", stm->getName());
-		return;
+		evalValue = initValue;
+		initValue = RValue(UndefValue::get(initValue.type()), initValue.stype());
 	}
 
 	auto varType = CGNDataType::run(context, stm->getType());
@@ -721,7 +2222,39 @@ void CreateGlobalVar_Internal(CodeContext& context, NGlobalVariableDecl* stm, bo
 
 	auto var = new GlobalVariable(*context.getModule(), *varType, false, GlobalValue::ExternalLinkage, declaration? nullptr : (Constant*) initValue.value(), name);
 	var->setConstant(varType->isConst());
-	context.storeGlobalSymbol({var, varType}, name);
+	var->setThreadLocalMode(tlsMode);
+	align = max(align, SType::userAlign(context, varType));
+	if (align) {
+		align = max(align, SType::allocAlign(context, varType));
+#if LLVM_VERSION_MAJOR >= 10
+		var->setAlignment(MaybeAlign(align));
+#else
+		var->setAlignment(align);
+#endif
+	}
+	RValue varSym(var, varType);
+	varSym.setAtomic(Builder::getAtomicAttr(context, stm->getAttrs(), varType, stm->getName()));
+	context.storeGlobalSymbol(varSym, name);
+
+	if (evalValue && !declaration) {
+		context.IB().CreateStore(evalValue, var);
+		context.IB().CreateRetVoid();
+		context.addGlobalInit(var, stm->getName());
+	}
+
+	auto allocAttr = NAttributeList::find(stm->getAttrs(), "allocator");
+	if (allocAttr) {
+		auto isAllocator = varType->isClass();
+		if (isAllocator) {
+			auto clType = static_cast<SClassType*>(varType);
+			isAllocator = clType->getItem("alloc") && clType->getItem("free");
+		}
+
+		if (!isAllocator)
+			context.addError("allocator variable requires class type with alloc and free functions", stm->getName());
+		else if (context.setAllocator({var, varType}))
+			context.addError("default allocator must be declared once, before any new or delete", *allocAttr);
+	}
 }
 
 void Builder::CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bool declaration)
@@ -731,6 +2264,41 @@ void Builder::CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bo
 	context.endTmpFunction();
 }
 
+void Builder::EvalGlobalInits(CodeContext& context)
+{
+	auto module = context.getModule();
+	TargetLibraryInfoImpl libInfoImpl(Triple(module->getTargetTriple()));
+	TargetLibraryInfo libInfo(libInfoImpl);
+
+	// in declaration order, so an initializer can load the value of a previous global
+	for (auto& item : context.getGlobalInits()) {
+		auto var = get<0>(item);
+		auto func = get<1>(item);
+		module->getFunctionList().push_back(func);
+
+		Evaluator eval(module->getDataLayout(), &libInfo);
+		Constant* retVal;
+		Constant* constVal = nullptr;
+		SmallVector<Constant*, 0> args;
+		if (eval.EvaluateFunction(func, retVal, args)) {
+#if LLVM_VERSION_MAJOR >= 14
+			auto mutated = eval.getMutatedInitializers();
+#else
+			auto& mutated = eval.getMutatedMemory();
+#endif
+			auto found = mutated.find(var);
+			if (found != mutated.end())
+				constVal = found->second;
+		}
+		func->eraseFromParent();
+
+		if (constVal)
+			var->setInitializer(constVal);
+		else
+			context.addError("global variables only support constant value initializer", &get<2>(item));
+	}
+}
+
 void Builder::LoadImport(CodeContext& context, NImportFileStm* stm)
 {
 	path filename;
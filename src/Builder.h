@@ -20,7 +20,19 @@
 
 enum class BuiltinFuncType
 {
-	Free, Malloc, Printf
+	Free, FreeSized, FreeAlignedSized, Malloc, AlignedAlloc, Printf, Strlen, Memcmp,
+	ParallelFor, Spawn, Sync
+};
+
+enum class BuiltinCallType
+{
+	ReduceAdd, ReduceMul, ReduceMin, ReduceMax, ReduceAnd, ReduceOr, ReduceXor,
+	Shuffle, Select, MaskedLoad, MaskedStore, Gather, Scatter,
+	Min, Max, Fma, Sqrt, Expect,
+	AtomicLoad, AtomicStore, AtomicExchange, AtomicCompareExchange,
+	AtomicFetchAdd, AtomicFetchSub, AtomicFetchAnd, AtomicFetchOr, AtomicFetchXor, Fence,
+	Spawn, Sync, Resume, Done, Destroy,
+	MemCopy, MemMove, MemSet, Prefetch, NonTemporalLoad, NonTemporalStore
 };
 
 class Builder
@@ -39,6 +51,40 @@ class Builder
 
 	static bool SetupClassDestructor(CodeContext& context, NClassDestructor* stm, bool prototype);
 
+	static SType* getVecArg(CodeContext& context, Token* name, RValue& arg);
+
+	static bool castMaskArg(CodeContext& context, Token* name, RValue& mask, SType* vecType);
+
+	static RValue CallVecReduce(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static RValue CallVecShuffle(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static RValue CallVecMemory(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static RValue CallMathFunc(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static RValue CallExpect(CodeContext& context, Token* name, VecRValue& args);
+
+	static RValue CallMemIntrinsic(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static RValue CallPrefetch(CodeContext& context, Token* name, VecRValue& args);
+
+	static RValue CallNonTemporal(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	static bool getAtomicOrder(CodeContext& context, Token* name, NExpression* exp, AtomicOrdering& order);
+
+	static RValue CallAtomic(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args, AtomicOrdering order);
+
+	static RValue CallSpawn(CodeContext& context, Token* name, VecRValue& args);
+
+	static void deduceTemplateArg(CodeContext& context, NDataType* param, SType* arg, NIdentifierList* names, VecSType& result);
+
+	static SFunctionType* getAsyncFuncType(CodeContext& context, SFunctionType* funcType, Token* name);
+
+	static void CreateCoroutineBegin(CodeContext& context, SType* yieldType, Token* name);
+
+	static void CreateCoroutineEnd(CodeContext& context, Token* name);
+
 public:
 	static SFunctionType* getFuncType(CodeContext& context, NDataType* retType, NDataTypeList* params);
 
@@ -46,21 +92,68 @@ public:
 
 	static SFunction getBuiltinFunc(CodeContext& context, const Token* source, BuiltinFuncType builtin);
 
+	static bool isBuiltinCall(const string& name);
+
+	static RValue CallBuiltin(CodeContext& context, NFunctionCall* exp);
+
 	static SFunction CreateFunction(CodeContext& context, Token* name, NDataType* rtype, NParameterList* params, NStatementList* body, NAttributeList* attrs = nullptr);
 
+	static RValue CallCoroutine(CodeContext& context, BuiltinCallType type, Token* name, VecRValue& args);
+
+	/**
+	 * suspends the current coroutine, when it's destroyed instead of resumed the live
+	 * locals and the awaited coroutine (if given) are destroyed before freeing the frame
+	 */
+	static void CreateCoroutineSuspend(CodeContext& context, BasicBlock* resumeBlock, Token* token, RValue awaited = {});
+
+	static RValue CreateClosure(CodeContext& context, NLambdaFunction* exp, Token* name);
+
 	static void AddDebugPrint(CodeContext& context, Token* source, const string& msg, vector<Value*> args);
 
+	static RValue getAllocator(CodeContext& context, NExpression* exp);
+
+	static RValue CallAllocator(CodeContext& context, RValue allocator, Token* token, const string& funcName, VecRValue& args);
+
+	static RValue getAllocSize(CodeContext& context, SType* type, RValue arrSize);
+
+	static void CallSizedFree(CodeContext& context, Token* token, RValue ptr, RValue size, uint64_t align);
+
 	static void CreateClassFunction(CodeContext& context, NClassFunctionDecl* stm, bool prototype);
 
 	static void CreateClassConstructor(CodeContext& context, NClassConstructor* stm, bool prototype);
 
 	static void CreateClassDestructor(CodeContext& context, NClassDestructor* stm, bool prototype);
 
+	static uint64_t getAlignAttr(CodeContext& context, NAttributeList* attrs);
+
+	static GlobalVariable::ThreadLocalMode getThreadLocalAttr(CodeContext& context, NAttributeList* attrs);
+
+	static bool getAtomicAttr(CodeContext& context, NAttributeList* attrs, SType* type, Token* name);
+
+	/**
+	 * loads an #[atomic] variable, always sequentially consistent
+	 */
+	static RValue LoadAtomic(CodeContext& context, RValue var);
+
+	/**
+	 * assignment (op is '=') or compound assignment to an #[atomic] variable,
+	 * returns the new value unless postfix is set, then the old value
+	 */
+	static RValue AtomicUpdate(CodeContext& context, RValue var, int op, RValue value, Token* token, bool postfix = false);
+
+	static MDNode* getLoopMetadata(CodeContext& context, NAttributeList* attrs);
+
+	static int getLikelyAttr(CodeContext& context, NAttributeList* attrs);
+
 	static bool StoreTemplate(CodeContext& context, NTemplatedDeclaration* stm);
 
+	static bool StoreFuncTemplate(CodeContext& context, NFunctionDeclaration* stm);
+
+	static RValue CallFuncTemplate(CodeContext& context, NFunctionCall* exp, NFunctionDeclaration* decl);
+
 	static void CreateClass(CodeContext& context, NClassDeclaration* stm, const function<void(int)>& visitor);
 
-	static void CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list);
+	static void CreateStruct(CodeContext& context, NStructDeclaration::CreateType ctype, Token* name, NVariableDeclGroupList* list, NAttributeList* attrs = nullptr);
 
 	static void CreateEnum(CodeContext& context, NEnumDeclaration* stm);
 
@@ -68,6 +161,13 @@ public:
 
 	static void CreateGlobalVar(CodeContext& context, NGlobalVariableDecl* stm, bool declaration);
 
+	/**
+	 * Runs the initializers of globals that didn't fold to a constant. The
+	 * evaluator stops at loops, so called #[const] functions must only use
+	 * straight-line and branching code.
+	 */
+	static void EvalGlobalInits(CodeContext& context);
+
 	static void LoadImport(CodeContext& context, NImportFileStm* stm);
 };
 
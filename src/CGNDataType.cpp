@@ -29,10 +29,12 @@ SType* CGNDataType::visit(NDataType* type)
 	VISIT_CASE_RETURN(NArrayType, type)
 	VISIT_CASE_RETURN(NBaseType, type)
 	VISIT_CASE_RETURN(NConstType, type)
+	VISIT_CASE_RETURN(NConstValueType, type)
 	VISIT_CASE_RETURN(NFuncPointerType, type)
 	VISIT_CASE_RETURN(NPointerType, type)
 	VISIT_CASE_RETURN(NReferenceType, type)
 	VISIT_CASE_RETURN(NCopyReferenceType, type)
+	VISIT_CASE_RETURN(NSliceType, type)
 	VISIT_CASE_RETURN(NThisType, type)
 	VISIT_CASE_RETURN(NUserType, type)
 	VISIT_CASE_RETURN(NVecType, type)
@@ -81,6 +83,18 @@ SType* CGNDataType::visitNConstType(NConstType* type)
 	return SType::getConst(context, visit(type->getType()));
 }
 
+SType* CGNDataType::visitNConstValueType(NConstValueType* type)
+{
+	auto value = CGNExpression::run(context, type->getValue());
+	if (!value || !isa<ConstantInt>(value.value()) || !value.stype()->isInteger()) {
+		context.addError("template value must be a constant integer or bool", *type);
+		return nullptr;
+	}
+	auto intVal = static_cast<ConstantInt*>(value.value());
+	auto val = value.stype()->isUnsigned()? intVal->getZExtValue() : intVal->getSExtValue();
+	return SType::getConstValue(context, value.stype(), val);
+}
+
 SType* CGNDataType::visitNThisType(NThisType* type)
 {
 	auto cl = context.getThis();
@@ -104,6 +118,16 @@ SType* CGNDataType::getArrayType(NArrayType* type)
 	return btype;
 }
 
+SType* CGNDataType::getUnsizedArray(NArrayType* type, SType* btype)
+{
+	// the member arrays of a soa array are placed using its length
+	if (btype->isStruct() && static_cast<SStructType*>(btype)->isSoaStruct()) {
+		context.addError("soa struct arrays require a constant size: " + btype->str(context), *type->getBaseType());
+		return nullptr;
+	}
+	return SType::getArray(context, btype, 0);
+}
+
 SType* CGNDataType::visitNArrayType(NArrayType* type)
 {
 	auto btype = getArrayType(type);
@@ -123,8 +147,21 @@ SType* CGNDataType::visitNArrayType(NArrayType* type)
 		}
 		return SType::getArray(context, btype, arrSize);
 	} else {
-		return SType::getArray(context, btype, 0);
+		return getUnsizedArray(type, btype);
+	}
+}
+
+SType* CGNDataType::visitNSliceType(NSliceType* type)
+{
+	auto baseType = type->getBaseType();
+	auto btype = visit(baseType);
+	if (!btype) {
+		return nullptr;
+	} else if (btype->isUnsized()) {
+		context.addError("can't create slice of " + btype->str(context) + " types", *baseType);
+		return nullptr;
 	}
+	return SType::getSlice(context, btype);
 }
 
 SType* CGNDataType::visitNVecType(NVecType* type)
@@ -157,7 +194,7 @@ SType* CGNDataType::visitNUserType(NUserType* type)
 	if (type->getTemplateArgs()) {
 		auto valid = true;
 		for (auto item : *type->getTemplateArgs()) {
-			auto arg = CGNDataType::run(context, item);
+			auto arg = CGNDataType::runTemplateArg(context, item);
 			valid &= arg != nullptr;
 			templateArgs.push_back(arg);
 		}
@@ -184,10 +221,27 @@ SType* CGNDataType::visitNUserType(NUserType* type)
 		}
 		context.addError(typeName + " type not declared", *type);
 		return nullptr;
+	} else if (ty->isConstValue()) {
+		context.addError(type->getName()->str + " is a template value, not a type", *type);
+		return nullptr;
 	}
 	return ty->isAlias()? ty->subType() : ty;
 }
 
+SType* CGNDataType::runTemplateArg(CodeContext& context, NDataType* type)
+{
+	// a template parameter bound to a value can be passed on as an argument
+	if (type->id() == NodeId::NUserType) {
+		auto userType = static_cast<NUserType*>(type);
+		if (!userType->getTemplateArgs() && context.inTemplate()) {
+			auto arg = context.getTemplateArg(userType->getName()->str);
+			if (arg && arg->isConstValue())
+				return arg;
+		}
+	}
+	return run(context, type);
+}
+
 SType* CGNDataType::visitNPointerType(NPointerType* type)
 {
 	auto baseType = type->getBaseType();
@@ -243,6 +297,7 @@ SType* CGNDataTypeNew::visit(NDataType* type)
 	VISIT_CASE_RETURN(NPointerType, type)
 	VISIT_CASE_RETURN(NReferenceType, type)
 	VISIT_CASE_RETURN(NCopyReferenceType, type)
+	VISIT_CASE_RETURN(NSliceType, type)
 	VISIT_CASE_RETURN(NThisType, type)
 	VISIT_CASE_RETURN(NUserType, type)
 	VISIT_CASE_RETURN(NVecType, type)
@@ -323,7 +378,15 @@ SType* CGNDataTypeNew::visitNArrayType(NArrayType* type)
 		}
 		setSize(sizeVal);
 	}
-	return SType::getArray(context, btype, 0);
+	return getUnsizedArray(type, btype);
+}
+
+SType* CGNDataTypeNew::visitNSliceType(NSliceType* type)
+{
+	auto ty = CGNDataType::visitNSliceType(type);
+	if (ty)
+		setSize(ty);
+	return ty;
 }
 
 SType* CGNDataTypeNew::visitNVecType(NVecType* type)
@@ -31,10 +31,14 @@ protected:
 
 	SType* visitNConstType(NConstType* type);
 
+	SType* visitNConstValueType(NConstValueType* type);
+
 	SType* visitNThisType(NThisType* type);
 
 	SType* visitNArrayType(NArrayType* type);
 
+	SType* visitNSliceType(NSliceType* type);
+
 	SType* visitNVecType(NVecType* type);
 
 	SType* visitNUserType(NUserType* type);
@@ -51,6 +55,8 @@ protected:
 
 	SType* getArrayType(NArrayType* type);
 
+	SType* getUnsizedArray(NArrayType* type, SType* btype);
+
 public:
 
 	static SType* run(CodeContext& context, NDataType* type)
@@ -58,6 +64,12 @@ public:
 		CGNDataType runner(context);
 		return runner.visit(type);
 	}
+
+	/**
+	 * same as run() but also accepts constant values, which are only
+	 * valid as template arguments
+	 */
+	static SType* runTemplateArg(CodeContext& context, NDataType* type);
 };
 
 class CGNDataTypeNew : public CGNDataType
@@ -76,6 +88,8 @@ class CGNDataTypeNew : public CGNDataType
 
 	SType* visitNArrayType(NArrayType* type);
 
+	SType* visitNSliceType(NSliceType* type);
+
 	SType* visitNVecType(NVecType* type);
 
 	SType* visitNUserType(NUserType* type);
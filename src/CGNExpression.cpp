@@ -25,6 +25,16 @@
 #include "CGNVariable.h"
 #include "Builder.h"
 
+RValue CGNExpression::run(CodeContext& context, NExpression* exp, bool derefRef)
+{
+	// each top level expression starts a new source location
+	auto debugInfo = context.getDebugInfo();
+	if (debugInfo && exp)
+		debugInfo->setLocation(context, *exp);
+	CGNExpression runner(context, derefRef);
+	return runner.visit(exp);
+}
+
 RValue CGNExpression::visit(NExpression* exp)
 {
 	if (!exp)
@@ -35,6 +45,7 @@ RValue CGNExpression::visit(NExpression* exp)
 	VISIT_CASE2_RETURN(NBaseVariable, NVariable, exp)
 	VISIT_CASE2_RETURN(NDereference, NVariable, exp)
 	VISIT_CASE2_RETURN(NMemberVariable, NVariable, exp)
+	VISIT_CASE2_RETURN(NSliceVariable, NVariable, exp)
 	VISIT_CASE_RETURN(NAddressOf, exp)
 	VISIT_CASE_RETURN(NAssignment, exp)
 	VISIT_CASE_RETURN(NBinaryMathOperator, exp)
@@ -105,6 +116,8 @@ RValue CGNExpression::visitNAssignment(NAssignment* exp)
 	if (lhsType->isReference()) {
 		lhsVar = Inst::Deref(context, lhsVar);
 		lhsType = lhsVar.stype();
+	} else if (lhsVar.isAtomic()) {
+		return Builder::AtomicUpdate(context, lhsVar, exp->getOp(), visit(exp->getRhs()), exp->getOpToken());
 	}
 
 	if (lhsType->isClass()) {
@@ -156,7 +169,7 @@ RValue CGNExpression::visitNAssignment(NAssignment* exp)
 		rhsExp = Inst::BinaryOp(exp->getOp(), *exp, lhsLocal, rhsExp, context);
 	}
 	Inst::CastTo(context, *exp->getRhs(), rhsExp, lhsType);
-	if (rhsExp)
+	if (rhsExp && !Inst::CopyAggregate(context, lhsVar, rhsExp))
 		context.IB().CreateStore(rhsExp, lhsVar);
 
 	if (exp->getOp() == ParserBase::TT_DQ_MARK) {
@@ -240,13 +253,38 @@ RValue CGNExpression::visitNNewExpression(NNewExpression* exp)
 	}
 
 	Token* expTok = *exp;
-	auto func = Builder::getBuiltinFunc(context, expTok, BuiltinFuncType::Malloc);
-	auto call = context.IB().CreateCall(func.funcType(), func.value(), {sizeBytes});
+	RValue ptr;
+	auto allocator = Builder::getAllocator(context, exp->getAllocator());
+	if (allocator) {
+		VecRValue allocArgs{sizeBytes, RValue::getNumVal(context, SType::allocAlign(context, nType), 64)};
+		ptr = Builder::CallAllocator(context, allocator, expTok, "alloc", allocArgs);
+		if (!ptr) {
+			return RValue();
+		} else if (!ptr.stype()->isPointer()) {
+			context.addError("allocator alloc function must return a pointer", expTok);
+			return RValue();
+		}
+	} else if (exp->getAllocator()) {
+		return RValue();
+	} else {
+		CallInst* call;
+		SFunction func;
+		auto align = SType::userAlign(context, nType);
+		// malloc only guarantees alignment for the fundamental types
+		if (align > 16) {
+			func = Builder::getBuiltinFunc(context, expTok, BuiltinFuncType::AlignedAlloc);
+			call = context.IB().CreateCall(func.funcType(), func.value(), {RValue::getNumVal(context, align, 64), sizeBytes});
+		} else {
+			func = Builder::getBuiltinFunc(context, expTok, BuiltinFuncType::Malloc);
+			call = context.IB().CreateCall(func.funcType(), func.value(), {sizeBytes});
+		}
+
+		if (context.config().count("print-debug"))
+			Builder::AddDebugPrint(context, expTok, "[DEBUG] malloc(%i) = %i at " + expTok->getLoc(), {sizeBytes, call});
 
-	if (context.config().count("print-debug"))
-		Builder::AddDebugPrint(context, expTok, "[DEBUG] malloc(%i) = %i at " + expTok->getLoc(), {sizeBytes, call});
+		ptr = RValue(call, func.returnTy());
+	}
 
-	auto ptr = RValue(call, func.returnTy());
 	auto ptrType = SType::getPointer(context, nType);
 	auto rPtr = RValue(context.IB().CreateBitCast(ptr, *ptrType), ptrType);
 
@@ -263,6 +301,8 @@ RValue CGNExpression::visitNLambdaFunction(NLambdaFunction* exp)
 	Token* tok = *exp;
 	auto fname = context.currFunction().name() + "_" + to_string(tok->line) + to_string(tok->col);
 	uPtr<Token> nameTok(new Token(*tok, fname.str()));
+	if (exp->getCaptures())
+		return Builder::CreateClosure(context, exp, nameTok.get());
 
 	auto newCtx = CodeContext::newForLambda(context);
 	auto lambda = Builder::CreateFunction(newCtx, nameTok.get(), exp->getReturnType(), exp->getParams(), exp->getBody());
@@ -377,8 +417,16 @@ RValue CGNExpression::visitNUnaryMathOperator(NUnaryMathOperator* exp)
 RValue CGNExpression::visitNFunctionCall(NFunctionCall* exp)
 {
 	auto funcName = exp->getName()->str;
+	auto funcTemplate = context.getFuncTemplate(funcName);
+	if (exp->getTemplateArgs() && !funcTemplate) {
+		context.addError(funcName + " is not a function template", *exp);
+		return {};
+	}
+
 	auto syms = context.loadSymbol(funcName);
-	if (syms.empty()) {
+	if (syms.empty() && funcTemplate) {
+		return Builder::CallFuncTemplate(context, exp, funcTemplate);
+	} else if (syms.empty()) {
 		auto cl = context.getClass();
 		if (cl) {
 			auto item = cl->getItem(funcName);
@@ -392,18 +440,28 @@ RValue CGNExpression::visitNFunctionCall(NFunctionCall* exp)
 				}
 			}
 		}
+		if (Builder::isBuiltinCall(funcName))
+			return Builder::CallBuiltin(context, exp);
 		context.addError("symbol " + funcName + " not defined", *exp);
 		return {};
 	}
 
 	VecSFunc funcs;
 	for (auto sym : syms) {
-		auto deSym = Inst::Deref(context, sym, true);
+		// function symbols are used directly to keep their attributes
+		auto deSym = sym.isFunction()? sym : Inst::Deref(context, sym, true);
 		if (deSym.isFunction())
 			funcs.push_back(static_cast<SFunction&>(deSym));
 	}
 
 	if (funcs.empty()) {
+		// closures are called directly through their call function
+		auto deSym = Inst::Deref(context, syms[0], true);
+		if (syms.size() == 1 && deSym.stype()->isClass() && static_cast<SClassType*>(deSym.stype())->getItem("call")) {
+			uPtr<NBaseVariable> closure(new NBaseVariable(exp->getName()->copy()));
+			Token callTok(*exp->getName(), "call");
+			return Inst::CallMemberFunction(context, closure.get(), &callTok, exp->getArguments());
+		}
 		context.addError("symbol " + funcName + " doesn't reference a function", *exp);
 		return RValue();
 	}
@@ -420,6 +478,10 @@ RValue CGNExpression::visitNMemberFunctionCall(NMemberFunctionCall* exp)
 RValue CGNExpression::visitNIncrement(NIncrement* exp)
 {
 	auto varPtr = CGNVariable::run(context, exp->getVar());
+	if (varPtr.isAtomic()) {
+		auto op = exp->getOp() == ParserBase::TT_INC? '+' : '-';
+		return Builder::AtomicUpdate(context, varPtr, op, RValue::getNumVal(context, varPtr.stype()), *exp, exp->postfix());
+	}
 	auto varVal = Inst::Load(context, varPtr);
 	if (!varVal)
 		return RValue();
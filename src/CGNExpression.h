@@ -73,11 +73,7 @@ class CGNExpression
 
 public:
 
-	static RValue run(CodeContext& context, NExpression* exp, bool derefRef = true)
-	{
-		CGNExpression runner(context, derefRef);
-		return runner.visit(exp);
-	}
+	static RValue run(CodeContext& context, NExpression* exp, bool derefRef = true);
 
 	static void run(CodeContext& context, NExpressionList* list)
 	{
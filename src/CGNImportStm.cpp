@@ -66,6 +66,7 @@ void CGNImportStm::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
 	for (auto variable : *stm->getVars()) {
 		variable->setDataType(stm->getType());
+		variable->setAttrs(stm->getAttrs());
 		visit(variable);
 	}
 }
@@ -88,7 +89,7 @@ void CGNImportStm::visitNStructDeclaration(NStructDeclaration* stm)
 	NVariableDeclGroupList empty;
 	auto vars = NAttributeList::find(stm->getAttrs(), "opaque")? &empty : stm->getVars();
 
-	Builder::CreateStruct(context, stm->getType(), stm->getName(), vars);
+	Builder::CreateStruct(context, stm->getType(), stm->getName(), vars, stm->getAttrs());
 }
 
 void CGNImportStm::visitNEnumDeclaration(NEnumDeclaration* stm)
@@ -98,6 +99,9 @@ void CGNImportStm::visitNEnumDeclaration(NEnumDeclaration* stm)
 
 void CGNImportStm::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
+	if (Builder::StoreFuncTemplate(context, stm))
+		return;
+
 	Builder::CreateFunction(context, stm->getName(), stm->getRType(), stm->getParams(), nullptr, stm->getAttrs());
 }
 
@@ -109,7 +113,7 @@ void CGNImportStm::visitNClassStructDecl(NClassStructDecl* stm)
 	NVariableDeclGroupList empty;
 	auto vars = NAttributeList::find(cl->getAttrs(), "opaque")? &empty : stm->getVarList();
 
-	Builder::CreateStruct(context, stType, stToken, vars);
+	Builder::CreateStruct(context, stType, stToken, vars, cl->getAttrs());
 }
 
 void CGNImportStm::visitNClassFunctionDecl(NClassFunctionDecl* stm)
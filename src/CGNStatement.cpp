@@ -15,6 +15,10 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <llvm/Support/Casting.h>
+#include <llvm/IR/CFG.h>
+#include <llvm/IR/Instructions.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Transforms/Utils/CodeExtractor.h>
 #include "Value.h"
 #include "AST.h"
 #include "CGNStatement.h"
@@ -27,10 +31,19 @@
 #include "CGNExpression.h"
 #include "CGNImportStm.h"
 
+// branch weights for likely/unlikely hints, same ratio as llvm.expect
+#define LIKELY_WEIGHT 2000
+#define UNLIKELY_WEIGHT 1
+#define NEUTRAL_WEIGHT 40
+
+// larger case ranges are checked with a compare instead of adding every value to the switch
+#define MAX_CASE_RANGE 256
+
 void CGNStatement::visit(NStatement* stm)
 {
 	switch (stm->id()) {
 	VISIT_CASE(NAliasDeclaration, stm)
+	VISIT_CASE(NAwaitStatement, stm)
 	VISIT_CASE(NClassConstructor, stm)
 	VISIT_CASE(NClassDeclaration, stm)
 	VISIT_CASE(NClassDestructor, stm)
@@ -40,6 +53,7 @@ void CGNStatement::visit(NStatement* stm)
 	VISIT_CASE(NDestructorCall, stm)
 	VISIT_CASE(NEnumDeclaration, stm)
 	VISIT_CASE(NExpressionStm, stm)
+	VISIT_CASE(NForEachStatement, stm)
 	VISIT_CASE(NForStatement, stm)
 	VISIT_CASE(NFunctionDeclaration, stm)
 	VISIT_CASE(NGlobalVariableDecl, stm)
@@ -59,6 +73,7 @@ void CGNStatement::visit(NStatement* stm)
 	VISIT_CASE(NVariableDecl, stm)
 	VISIT_CASE(NVariableDeclGroup, stm)
 	VISIT_CASE(NWhileStatement, stm)
+	VISIT_CASE(NYieldStatement, stm)
 	default:
 		context.addError("NodeId::" + to_string(static_cast<int>(stm->id())) + " unrecognized in CGNStatement", nullptr);
 	}
@@ -87,24 +102,37 @@ void CGNStatement::visitNImportPkgStm(NImportPkgStm* stm)
 
 void CGNStatement::visitNExpressionStm(NExpressionStm* stm)
 {
-	CGNExpression::run(context, stm->getExp());
+	auto value = CGNExpression::run(context, stm->getExp());
+
+	// a large aggregate assignment is copied using memcpy, so the
+	// load of the value is unused when the result isn't needed
+	auto load = value? dyn_cast<LoadInst>(value.value()) : nullptr;
+	if (load && load->use_empty() && Inst::AggregateByteSize(context, value.stype()))
+		load->eraseFromParent();
 }
 
 void CGNStatement::visitNParameter(NParameter* stm)
 {
 	auto stype = CGNDataType::run(context, stm->getType());
-	auto stackAlloc = context.IB().CreateAlloca(*stype);
+	auto stackAlloc = Inst::Alloca(context, stype);
 	context.IB().CreateStore(storedValue, stackAlloc);
 	context.storeLocalSymbol({stackAlloc, stype}, stm->getName()->str, true);
+	if (auto debugInfo = context.getDebugInfo()) {
+		auto argNo = cast<Argument>(storedValue.value())->getArgNo() + 1;
+		debugInfo->declareVariable(context, stackAlloc, stype, stm->getName(), argNo);
+	}
 }
 
 void CGNStatement::visitNVariableDecl(NVariableDecl* stm)
 {
 	auto initList = CGNExpression::collect(context, stm->getInitList());
+	NExpression* copySrc = nullptr;
 	if (!initList) {
 		auto initExp = stm->getInitExp();
 		if (initExp) {
-			auto initValue = CGNExpression::run(context, initExp, false);
+			// copy directly into the variable instead of through a temporary
+			copySrc = getCopySource(initExp);
+			auto initValue = copySrc ? CGNExpression::run(context, copySrc) : CGNExpression::run(context, initExp, false);
 			initList = std::make_unique<VecRValue>();
 			initList->push_back(initValue);
 		}
@@ -141,18 +169,36 @@ void CGNStatement::visitNVariableDecl(NVariableDecl* stm)
 		return;
 	}
 
+	if (copySrc && varType->isReference() && initList->at(0)) {
+		// a reference needs the temporary to bind to
+		auto copy = Inst::Copy(context, initList->at(0), *copySrc);
+		initList->at(0) = Inst::Load(context, copy);
+		initList->at(0).setMove(true);
+	}
+
 	if (initList && initList->size() == 1 && initList->at(0) && initList->at(0).stype()->isReference() && !varType->isPointer()) {
 		initList->at(0) = Inst::Deref(context, initList->at(0));
 	}
 
+	if (NAttributeList::find(stm->getAttrs(), "packed")) {
+		context.addError("packed attribute only valid for struct, union or class", stm->getName());
+		return;
+	}
+	auto align = Builder::getAlignAttr(context, stm->getAttrs());
+
 	auto name = stm->getName()->str;
 	if (context.loadSymbolCurr(name).size()) {
 		context.addError("variable " + name + " already defined", stm->getName());
 		return;
 	}
 
-	auto var = RValue(context.IB().CreateAlloca(*varType, nullptr, name), varType);
+	auto var = RValue(Inst::Alloca(context, varType, name, align), varType);
+	var.setAtomic(Builder::getAtomicAttr(context, stm->getAttrs(), varType, stm->getName()));
 	context.storeLocalSymbol(var, name);
+	if (auto debugInfo = context.getDebugInfo()) {
+		debugInfo->setLocation(context, stm->getName());
+		debugInfo->declareVariable(context, var, varType, stm->getName());
+	}
 
 	Inst::InitVariable(context, var, {}, initList.get(), stm->getName());
 }
@@ -161,6 +207,7 @@ void CGNStatement::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
 	for (auto variable : *stm->getVars()) {
 		variable->setDataType(stm->getType());
+		variable->setAttrs(stm->getAttrs());
 		visit(variable);
 	}
 }
@@ -180,7 +227,7 @@ void CGNStatement::visitNStructDeclaration(NStructDeclaration* stm)
 	if (Builder::StoreTemplate(context, stm))
 		return;
 
-	Builder::CreateStruct(context, stm->getType(), stm->getName(), stm->getVars());
+	Builder::CreateStruct(context, stm->getType(), stm->getName(), stm->getVars(), stm->getAttrs());
 }
 
 void CGNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
@@ -190,6 +237,9 @@ void CGNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
 
 void CGNStatement::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
+	if (Builder::StoreFuncTemplate(context, stm))
+		return;
+
 	Builder::CreateFunction(context, stm->getName(), stm->getRType(), stm->getParams(), stm->getBody(), stm->getAttrs());
 }
 
@@ -198,7 +248,7 @@ void CGNStatement::visitNClassStructDecl(NClassStructDecl* stm)
 	auto cl = stm->getClass();
 	auto stToken = cl->getName();
 	auto stType = NStructDeclaration::CreateType::CLASS;
-	Builder::CreateStruct(context, stType, stToken, stm->getVarList());
+	Builder::CreateStruct(context, stType, stToken, stm->getVarList(), cl->getAttrs());
 }
 
 void CGNStatement::visitNClassFunctionDecl(NClassFunctionDecl* stm)
@@ -260,13 +310,74 @@ void CGNStatement::visitNClassDeclaration(NClassDeclaration* stm)
 	});
 }
 
+NExpression* CGNStatement::getCopySource(NExpression* exp)
+{
+	if (!exp || exp->id() != NodeId::NArrowOperator)
+		return nullptr;
+
+	auto arrow = static_cast<NArrowOperator*>(exp);
+	if (arrow->getType() != NArrowOperator::EXP || arrow->getName()->str != "copy" || (arrow->getArgs() && arrow->getArgs()->size()))
+		return nullptr;
+	return arrow->getExp();
+}
+
+bool CGNStatement::isDyingLocal(NExpression* exp)
+{
+	if (exp->id() != NodeId::NBaseVariable)
+		return false;
+
+	auto var = CGNVariable::run(context, static_cast<NBaseVariable*>(exp));
+	if (!var)
+		return false;
+
+	// parameters and globals aren't destroyed by this function
+	auto locals = context.getDestructables(0);
+	return any_of(locals.begin(), locals.end(), [&](auto& item){ return item.value() == var.value(); });
+}
+
+void CGNStatement::setMustTail(NReturnStatement* stm, const RValue& returnVal, ReturnInst* ret)
+{
+	auto call = dyn_cast_or_null<CallInst>(returnVal.value());
+	if (!call) {
+		context.addError("tail call requires returning a function call", *stm);
+		return;
+	} else if (ret->getPrevNode() != call || (ret->getReturnValue() && ret->getReturnValue() != call)) {
+		context.addError("tail call must be the last operation before return, check return type and destructors", *stm);
+		return;
+	} else if (call->getFunctionType() != context.currFunction().funcValue()->getFunctionType()) {
+		context.addError("tail call requires the called function to have the same signature as the caller", *stm);
+		return;
+	}
+#if LLVM_VERSION_MAJOR >= 14
+	for (auto& arg : call->args()) {
+#else
+	for (auto& arg : call->arg_operands()) {
+#endif
+		if (isa<AllocaInst>(arg->stripInBoundsOffsets())) {
+			context.addError("tail call arguments can't reference local variables", *stm);
+			return;
+		}
+	}
+	call->setTailCallKind(CallInst::TCK_MustTail);
+}
+
 void CGNStatement::visitNReturnStatement(NReturnStatement* stm)
 {
+	if (auto debugInfo = context.getDebugInfo())
+		debugInfo->setLocation(context, *stm);
+
+	if (context.getCoroutine()) {
+		visitAsyncReturn(stm);
+		return;
+	}
+
 	auto func = context.currFunction();
 	auto funcReturn = func.returnTy();
+	auto tailCall = NAttributeList::find(stm->getAttrs(), "tailcall");
 
 	if (funcReturn->isVoid()) {
-		if (stm->getValue()) {
+		// a tail call to a void function is allowed to be returned
+		if (stm->getValue() && !tailCall) {
 			context.addError("function " + func.name().str() + " declared void, but non-void return found", *stm->getValue());
 			return;
 		}
@@ -275,9 +386,18 @@ void CGNStatement::visitNReturnStatement(NReturnStatement* stm)
 		return;
 	}
 
-	auto returnVal = CGNExpression::run(context, stm->getValue());
+	// returning a copy of a local that's about to be destroyed can move it instead
+	auto copySrc = getCopySource(stm->getValue());
+	RValue returnVal;
+	if (copySrc && isDyingLocal(copySrc)) {
+		returnVal = CGNExpression::run(context, copySrc);
+		returnVal.setMove(true);
+	} else {
+		returnVal = CGNExpression::run(context, stm->getValue());
+	}
+
 	RValue retAlloc;
-	if (returnVal) {
+	if (returnVal && !funcReturn->isVoid()) {
 		Inst::CastTo(context, *stm->getValue(), returnVal, funcReturn);
 		retAlloc = Inst::PtrOfLoad(context, returnVal);
 
@@ -289,17 +409,125 @@ void CGNStatement::visitNReturnStatement(NReturnStatement* stm)
 
 	Inst::CallDestructables(context, retAlloc.value(), *stm);
 
-	context.IB().CreateRet(returnVal);
+	auto ret = context.IB().CreateRet(funcReturn->isVoid()? nullptr : returnVal.value());
+	if (tailCall)
+		setMustTail(stm, returnVal, ret);
+
+	context.pushBlock(context.createBlock());
+}
+
+bool CGNStatement::storePromise(NExpression* exp, Token* token)
+{
+	auto coro = context.getCoroutine();
+	if (coro->yieldType->isVoid()) {
+		if (exp) {
+			context.addError("async function " + context.currFunction().name().str() + " declared void, but value found", *exp);
+			return false;
+		}
+		return true;
+	} else if (!exp) {
+		context.addError("async function " + context.currFunction().name().str() + " declared non-void, but no value found", token);
+		return false;
+	}
+
+	auto value = CGNExpression::run(context, exp);
+	if (!value || Inst::CastTo(context, *exp, value, coro->promise.stype()))
+		return false;
+	context.IB().CreateStore(value, coro->promise);
+	return true;
+}
+
+void CGNStatement::visitAsyncReturn(NReturnStatement* stm)
+{
+	if (NAttributeList::find(stm->getAttrs(), "tailcall")) {
+		context.addError("async function can not return a tail call", *stm);
+		return;
+	}
+
+	// the final value is optional, the caller reads it through the promise
+	auto coro = context.getCoroutine();
+	if (stm->getValue() && !storePromise(stm->getValue(), *stm))
+		return;
 
+	Inst::CallDestructables(context, nullptr, *stm);
+	context.IB().CreateBr(coro->finalBlock);
 	context.pushBlock(context.createBlock());
 }
 
+void CGNStatement::visitNYieldStatement(NYieldStatement* stm)
+{
+	if (!context.getCoroutine()) {
+		context.addError("yield requires an async function", *stm);
+		return;
+	} else if (!storePromise(stm->getValue(), *stm)) {
+		return;
+	}
+
+	auto resumeBlock = context.createBlock();
+	Builder::CreateCoroutineSuspend(context, resumeBlock, *stm);
+	context.pushBlock(resumeBlock);
+}
+
+void CGNStatement::visitNAwaitStatement(NAwaitStatement* stm)
+{
+	if (!context.getCoroutine()) {
+		context.addError("await requires an async function", *stm);
+		return;
+	}
+
+	Token* token = *stm;
+	VecRValue args{CGNExpression::run(context, stm->getValue())};
+	if (!args[0])
+		return;
+
+	// a coroutine created by the await expression is owned by it
+	auto valueId = stm->getValue()->id();
+	auto isTemp = valueId == NodeId::NFunctionCall || valueId == NodeId::NMemberFunctionCall;
+
+	// suspend until the awaited coroutine finishes, resuming it each time this one is resumed
+	auto condBlock = context.createBlock();
+	auto suspendBlock = context.createBlock();
+	auto endBlock = context.createBlock();
+	context.IB().CreateBr(condBlock);
+
+	context.pushBlock(condBlock);
+	auto done = Builder::CallCoroutine(context, BuiltinCallType::Done, token, args);
+	if (!done)
+		return;
+	context.IB().CreateCondBr(done, endBlock, suspendBlock);
+
+	context.pushBlock(suspendBlock);
+	auto resumeBlock = context.createBlock();
+	Builder::CreateCoroutineSuspend(context, resumeBlock, token, isTemp? args[0] : RValue());
+	context.pushBlock(resumeBlock);
+	Builder::CallCoroutine(context, BuiltinCallType::Resume, token, args);
+	context.IB().CreateBr(condBlock);
+
+	context.pushBlock(endBlock);
+	if (isTemp)
+		Builder::CallCoroutine(context, BuiltinCallType::Destroy, token, args);
+}
+
+void CGNStatement::setLoopMetadata(NConditionStmt* stm, BasicBlock* header, Instruction* entry)
+{
+	auto loopID = Builder::getLoopMetadata(context, stm->getAttrs());
+	if (!loopID)
+		return;
+
+	// every back-edge to the header must carry the same loop id
+	for (auto pred : predecessors(header)) {
+		auto term = pred->getTerminator();
+		if (term && term != entry)
+			term->setMetadata(LLVMContext::MD_loop, loopID);
+	}
+}
+
 void CGNStatement::visitNLoopStatement(NLoopStatement* stm)
 {
 	auto bodyBlock = context.createContinueBlock();
 	auto endBlock = context.createBreakBlock();
 
-	context.IB().CreateBr(bodyBlock);
+	auto entry = context.IB().CreateBr(bodyBlock);
 	context.pushBlock(bodyBlock);
 
 	context.pushLocalTable();
@@ -307,6 +535,7 @@ void CGNStatement::visitNLoopStatement(NLoopStatement* stm)
 	context.popLocalTable();
 
 	context.IB().CreateBr(bodyBlock);
+	setLoopMetadata(stm, bodyBlock, entry);
 	context.pushBlock(endBlock);
 
 	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE);
@@ -322,7 +551,7 @@ void CGNStatement::visitNWhileStatement(NWhileStatement* stm)
 	auto trueBlock = stm->until()? endBlock : bodyBlock;
 	auto falseBlock = stm->until()? bodyBlock : endBlock;
 
-	context.IB().CreateBr(startBlock);
+	auto entry = context.IB().CreateBr(startBlock);
 	context.pushBlock(condBlock);
 
 	context.pushLocalTable();
@@ -332,20 +561,151 @@ void CGNStatement::visitNWhileStatement(NWhileStatement* stm)
 	context.popLocalTable();
 
 	context.IB().CreateBr(condBlock);
+	setLoopMetadata(stm, startBlock, entry);
 	context.pushBlock(endBlock);
 
 	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE | BranchType::REDO);
 }
 
+/**
+ * string switches are lowered to a switch on the string length, then a switch
+ * on the byte that best separates the strings of that length, and finally a
+ * memcmp against each remaining candidate
+ * @return the index of the matching case value or -1 if no case matches
+ */
+RValue CGNStatement::stringSwitchIndex(NSwitchStatement* stm, RValue switchValue)
+{
+	auto stype = switchValue.stype();
+	auto isSlice = stype->isSlice();
+	auto elementType = isSlice? stype->subType() : stype->isPointer() && stype->subType()->isArray()? stype->subType()->subType() : nullptr;
+	if (!elementType || !elementType->isInteger() || elementType->size() != 8) {
+		context.addError("switch requires int or string type", *stm->getValue());
+		return {};
+	}
+
+	Token* token = *stm->getValue();
+	auto i8Ty = Type::getInt8Ty(context);
+	auto i64Ty = Type::getInt64Ty(context);
+	auto bytePtrTy = PointerType::getUnqual(i8Ty);
+
+	Value *data, *len;
+	if (isSlice) {
+		data = context.IB().CreateBitCast(context.IB().CreateExtractValue(switchValue, 0), bytePtrTy);
+		len = context.IB().CreateExtractValue(switchValue, 1);
+	} else {
+		data = context.IB().CreateBitCast(switchValue, bytePtrTy);
+		auto strlenFunc = Builder::getBuiltinFunc(context, token, BuiltinFuncType::Strlen);
+		len = context.IB().CreateCall(strlenFunc.funcType(), strlenFunc.value(), {data});
+	}
+
+	// group the case strings by length
+	map<uint64_t, vector<pair<string, int>>> lengths;
+	set<string> unique;
+	int caseIdx = 0;
+	for (auto caseItem : *stm->getCases()) {
+		if (!caseItem->isValueCase())
+			continue;
+		auto value = caseItem->getValue();
+		if (caseItem->isRangeCase()) {
+			context.addError("case range requires int type", *value);
+		} else if (value->id() != NodeId::NStringLiteral) {
+			context.addError("case value must be a constant string", *value);
+		} else {
+			auto str = static_cast<NStringLiteral*>(value)->getStr();
+			if (!unique.insert(str).second)
+				context.addError("switch case values are not unique", *value);
+			else
+				lengths[str.size()].push_back({str, caseIdx});
+		}
+		caseIdx++;
+	}
+
+	auto i32Ty = Type::getInt32Ty(context);
+	auto noMatch = ConstantInt::get(i32Ty, -1);
+	auto endBlock = context.createBlock();
+	auto lenSwitch = context.IB().CreateSwitch(len, endBlock, lengths.size());
+	vector<pair<BasicBlock*, Value*>> results{{context.currBlock(), noMatch}};
+
+	for (auto& item : lengths) {
+		auto lenBlock = context.createBlock();
+		lenSwitch->addCase(ConstantInt::get(i64Ty, item.first), lenBlock);
+		context.pushBlock(lenBlock);
+
+		auto& strs = item.second;
+		if (item.first == 0) {
+			results.push_back({lenBlock, ConstantInt::get(i32Ty, strs[0].second)});
+			context.IB().CreateBr(endBlock);
+			continue;
+		}
+
+		// pick the position with the most distinct bytes
+		size_t bestPos = 0, bestCount = 0;
+		for (size_t pos = 0; pos < item.first && bestCount < strs.size(); pos++) {
+			set<char> bytes;
+			for (auto& str : strs)
+				bytes.insert(str.first[pos]);
+			if (bytes.size() > bestCount) {
+				bestCount = bytes.size();
+				bestPos = pos;
+			}
+		}
+		map<uint8_t, vector<pair<string, int>>> groups;
+		for (auto& str : strs)
+			groups[str.first[bestPos]].push_back(str);
+
+		auto bytePtr = context.IB().CreateInBoundsGEP(i8Ty, data, ConstantInt::get(i64Ty, bestPos));
+		auto byteSwitch = context.IB().CreateSwitch(context.IB().CreateLoad(i8Ty, bytePtr), endBlock, groups.size());
+		results.push_back({context.currBlock(), noMatch});
+
+		for (auto& group : groups) {
+			auto groupBlock = context.createBlock();
+			byteSwitch->addCase(ConstantInt::get(Type::getInt8Ty(context), group.first), groupBlock);
+			context.pushBlock(groupBlock);
+
+			auto& cands = group.second;
+			for (size_t i = 0; i < cands.size(); i++) {
+				auto idx = ConstantInt::get(i32Ty, cands[i].second);
+				if (item.first == 1) {
+					// the byte switch already matched the whole string
+					results.push_back({context.currBlock(), idx});
+					context.IB().CreateBr(endBlock);
+					break;
+				}
+				auto memcmpFunc = Builder::getBuiltinFunc(context, token, BuiltinFuncType::Memcmp);
+				auto lit = context.IB().CreateGlobalStringPtr(cands[i].first);
+				auto cmp = context.IB().CreateCall(memcmpFunc.funcType(), memcmpFunc.value(), {data, lit, ConstantInt::get(i64Ty, item.first)});
+				auto isEq = context.IB().CreateICmpEQ(cmp, ConstantInt::get(i32Ty, 0));
+				if (i + 1 == cands.size()) {
+					results.push_back({context.currBlock(), context.IB().CreateSelect(isEq, idx, noMatch)});
+					context.IB().CreateBr(endBlock);
+				} else {
+					auto nextBlock = context.createBlock();
+					results.push_back({context.currBlock(), idx});
+					context.IB().CreateCondBr(isEq, endBlock, nextBlock);
+					context.pushBlock(nextBlock);
+				}
+			}
+		}
+	}
+
+	context.pushBlock(endBlock);
+	auto phi = context.IB().CreatePHI(i32Ty, results.size());
+	for (auto& result : results)
+		phi->addIncoming(result.second, result.first);
+	return RValue(phi, SType::getInt(context, 32));
+}
+
 void CGNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 {
 	auto switchValue = CGNExpression::run(context, stm->getValue());
 	if (!switchValue)
 		return;
 
-	if (!switchValue.stype()->isInteger()) {
-		context.addError("switch requires int type", *stm->getValue());
-		return;
+	auto isString = !switchValue.stype()->isInteger();
+	if (isString) {
+		switchValue = stringSwitchIndex(stm, switchValue);
+		if (!switchValue)
+			return;
 	}
 
 	auto caseBlock = context.createBlock();
@@ -353,25 +713,67 @@ void CGNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 	auto defaultBlock = endBlock;
 	auto switchInst = context.IB().CreateSwitch(switchValue, defaultBlock, stm->getCases()->size());
 
-	set<int64_t> unique;
+	// case values as non-overlapping ranges, ordered by their value
+	auto isUnsigned = switchValue.stype()->isUnsigned();
+	auto key = [=](ConstantInt* val) {
+		return isUnsigned? val->getZExtValue() : static_cast<uint64_t>(val->getSExtValue()) ^ (1ULL << 63);
+	};
+	map<uint64_t, uint64_t> unique;
+	// ranges too large to add to the switch, checked before the default case
+	vector<tuple<ConstantInt*, ConstantInt*, BasicBlock*, uint32_t>> largeRanges;
+	int stringIdx = 0;
 	bool hasDefault = false;
+	bool hasHint = false;
+	// first weight is for the default destination
+	vector<uint32_t> weights{NEUTRAL_WEIGHT};
 	for (auto caseItem : *stm->getCases()) {
-		if (caseItem->isValueCase()) {
+		auto likely = Builder::getLikelyAttr(context, caseItem->getAttrs());
+		auto weight = likely > 0? LIKELY_WEIGHT : likely < 0? UNLIKELY_WEIGHT : NEUTRAL_WEIGHT;
+		hasHint |= likely != 0;
+
+		if (isString && caseItem->isValueCase()) {
+			// errors were already reported by stringSwitchIndex
+			switchInst->addCase(ConstantInt::get(Type::getInt32Ty(context), stringIdx++), caseBlock);
+			weights.push_back(weight);
+		} else if (caseItem->isValueCase()) {
 			auto caseVal = CGNExpression::run(context, caseItem->getValue());
+			auto endVal = caseItem->isRangeCase()? CGNExpression::run(context, caseItem->getEndValue()) : caseVal;
 			if (!caseVal || !isa<ConstantInt>(caseVal.value())) {
 				context.addError("case value must be a constant int", *caseItem->getValue());
+			} else if (!endVal || !isa<ConstantInt>(endVal.value())) {
+				context.addError("case value must be a constant int", *caseItem->getEndValue());
 			} else {
 				Inst::CastTo(context, *caseItem->getValue(), caseVal, switchValue.stype());
+				if (caseItem->isRangeCase())
+					Inst::CastTo(context, *caseItem->getEndValue(), endVal, switchValue.stype());
 				auto val = static_cast<ConstantInt*>(caseVal.value());
-				if (!unique.insert(val->getSExtValue()).second)
+				auto end = static_cast<ConstantInt*>(endVal.value());
+				auto lo = key(val), hi = key(end);
+
+				auto overlap = unique.upper_bound(hi);
+				if (lo > hi) {
+					context.addError("case range start is greater than end", *caseItem->getValue());
+				} else if (overlap != unique.begin() && (--overlap)->second >= lo) {
 					context.addError("switch case values are not unique", *caseItem->getValue());
-				switchInst->addCase(val, caseBlock);
+				} else if (hi - lo >= MAX_CASE_RANGE) {
+					unique[lo] = hi;
+					largeRanges.emplace_back(val, end, caseBlock, weight);
+				} else {
+					unique[lo] = hi;
+					auto count = hi - lo + 1;
+					auto caseValue = val->getValue();
+					for (uint64_t i = 0; i < count; i++, caseValue++) {
+						switchInst->addCase(ConstantInt::get(context, caseValue), caseBlock);
+						weights.push_back(max<uint32_t>(weight / count, 1));
+					}
+				}
 			}
 		} else {
 			if (hasDefault)
 				context.addError("switch statement has more than one default", *caseItem);
 			hasDefault = true;
 			defaultBlock = caseBlock;
+			weights[0] = weight;
 		}
 
 		context.pushLocalTable();
@@ -388,7 +790,22 @@ void CGNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 			context.pushBlock(caseBlock);
 		}
 	}
+	// check the large ranges before falling through to the default case
+	for (auto range = largeRanges.rbegin(); range != largeRanges.rend(); range++) {
+		auto rangeBlock = context.createBlock();
+		IRBuilder<> builder(rangeBlock);
+		auto lo = get<0>(*range), hi = get<1>(*range);
+		auto offset = builder.CreateSub(switchValue, lo);
+		auto inRange = builder.CreateICmpULE(offset, ConstantExpr::getSub(hi, lo));
+		auto branch = builder.CreateCondBr(inRange, get<2>(*range), defaultBlock);
+		if (hasHint)
+			branch->setMetadata(LLVMContext::MD_prof, MDBuilder(context).createBranchWeights(get<3>(*range), weights[0]));
+		weights[0] += get<3>(*range);
+		defaultBlock = rangeBlock;
+	}
 	switchInst->setDefaultDest(defaultBlock);
+	if (hasHint)
+		switchInst->setMetadata(LLVMContext::MD_prof, MDBuilder(context).createBranchWeights(weights));
 
 	// NOTE: the last case will create a dangling block which needs a terminator.
 	context.IB().CreateBr(endBlock);
@@ -397,8 +814,234 @@ void CGNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 	context.pushBlock(endBlock);
 }
 
+/**
+ * moves the loop into a function called with a [lo, hi) range and replaces it
+ * with a call to the runtime, which runs chunks of the range on its threads
+ * @return true if the loop couldn't be outlined
+ */
+bool CGNStatement::outlineParallelFor(NAttribute* attr, SmallVector<BasicBlock*, 8>& region, BasicBlock* condBlock, Instruction* lo, Instruction* hi, Value* start, Value* end)
+{
+	set<BasicBlock*> regionSet(region.begin(), region.end());
+	auto endBlock = condBlock->getTerminator()->getSuccessor(1);
+	for (auto block : region) {
+		auto term = block->getTerminator();
+		if (!term) {
+			new UnreachableInst(block->getContext(), block);
+			continue;
+		} else if (isa<ReturnInst>(term)) {
+			context.addError("return not allowed in parallel for loop", *attr);
+			return true;
+		}
+		for (unsigned i = 0; i < term->getNumSuccessors(); i++) {
+			auto succ = term->getSuccessor(i);
+			if (succ == endBlock && block != condBlock) {
+				context.addError("break not allowed in parallel for loop", *attr);
+				return true;
+			} else if (succ != endBlock && !regionSet.count(succ)) {
+				context.addError("goto out of parallel for loop not allowed", *attr);
+				return true;
+			}
+		}
+	}
+
+	// temporaries allocated in the function's entry that are only used in the loop
+	// are moved into it, otherwise every thread would share the same one
+	auto& funcEntry = context.currFunction().funcValue()->getEntryBlock();
+	auto inRegion = [&](User* user){ return regionSet.count(cast<Instruction>(user)->getParent()); };
+	for (auto inst = funcEntry.begin(); inst != funcEntry.end();) {
+		auto alloc = dyn_cast<AllocaInst>(&*inst++);
+		if (alloc && !alloc->user_empty() && all_of(alloc->user_begin(), alloc->user_end(), inRegion))
+			alloc->moveBefore(&*region[0]->getFirstInsertionPt());
+	}
+
+#if LLVM_VERSION_MAJOR >= 9
+	CodeExtractor extractor(region, nullptr, false, nullptr, nullptr, nullptr, false, true);
+#else
+	CodeExtractor extractor(region, nullptr, false, nullptr, nullptr, false, true);
+#endif
+	if (!extractor.isEligible()) {
+		context.addError("parallel for loop body can't be outlined", *attr);
+		return true;
+	}
+#if LLVM_VERSION_MAJOR >= 10
+	CodeExtractorAnalysisCache analysisCache(*context.currFunction().funcValue());
+	auto outlined = extractor.extractCodeRegion(analysisCache);
+#else
+	auto outlined = extractor.extractCodeRegion();
+#endif
+	if (!outlined) {
+		context.addError("parallel for loop body can't be outlined", *attr);
+		return true;
+	}
+	auto call = cast<CallInst>(*outlined->user_begin());
+	vector<Value*> callOps(call->arg_begin(), call->arg_end());
+
+	// locals declared in the body are allocated once per chunk, not once per iteration
+	auto outlinedEntry = &outlined->getEntryBlock();
+	for (auto& block : *outlined) {
+		if (&block == outlinedEntry)
+			continue;
+		for (auto inst = block.begin(); inst != block.end();) {
+			auto alloc = dyn_cast<AllocaInst>(&*inst++);
+			if (alloc && isa<ConstantInt>(alloc->getArraySize()))
+				alloc->moveBefore(outlinedEntry->getTerminator());
+		}
+	}
+
+	// every argument other than the range is passed through a context struct
+	LLVMContext& llvmContext = context;
+	vector<Type*> fields;
+	vector<Value*> values;
+	for (auto arg : callOps) {
+		if (arg != lo && arg != hi) {
+			fields.push_back(arg->getType());
+			values.push_back(arg);
+		}
+	}
+	auto dataType = StructType::get(llvmContext, fields);
+	auto bytePtr = SType::getPointer(context, SType::getInt(context, 8));
+	auto int64Ty = SType::getInt(context, 64);
+	auto chunkType = SType::getFunction(context, SType::getVoid(context), {bytePtr, int64Ty, int64Ty});
+	auto chunk = Function::Create(chunkType->funcType(), GlobalValue::InternalLinkage, outlined->getName() + "_chunk", context.getModule());
+
+	IRBuilder<> builder(BasicBlock::Create(llvmContext, "", chunk));
+	auto chunkArg = chunk->arg_begin();
+	auto chunkData = builder.CreateBitCast(&*chunkArg++, dataType->getPointerTo());
+	auto chunkLo = &*chunkArg++;
+	auto chunkHi = &*chunkArg;
+	vector<Value*> callArgs;
+	unsigned field = 0;
+	for (auto arg : callOps) {
+		if (arg == lo) {
+			callArgs.push_back(chunkLo);
+		} else if (arg == hi) {
+			callArgs.push_back(chunkHi);
+		} else {
+			callArgs.push_back(builder.CreateLoad(fields[field], builder.CreateStructGEP(dataType, chunkData, field)));
+			field++;
+		}
+	}
+	builder.CreateCall(outlined->getFunctionType(), outlined, callArgs);
+	builder.CreateRetVoid();
+
+	builder.SetInsertPoint(&funcEntry, funcEntry.begin());
+	auto data = builder.CreateAlloca(dataType);
+	builder.SetInsertPoint(call);
+	for (unsigned i = 0; i < values.size(); i++)
+		builder.CreateStore(values[i], builder.CreateStructGEP(dataType, data, i));
+	auto runtime = Builder::getBuiltinFunc(context, *attr, BuiltinFuncType::ParallelFor);
+	builder.CreateCall(runtime.funcType(), runtime.value(), {chunk, builder.CreateBitCast(data, *bytePtr), start, end});
+
+	call->eraseFromParent();
+	lo->replaceAllUsesWith(start);
+	lo->eraseFromParent();
+	hi->replaceAllUsesWith(end);
+	hi->eraseFromParent();
+	return false;
+}
+
+void CGNStatement::visitParallelFor(NForStatement* stm, NAttribute* attr)
+{
+	// only loops over a range can be split into chunks
+	auto preStm = stm->getPreStm();
+	auto declGroup = preStm->size() == 1 && preStm->at(0)->id() == NodeId::NVariableDeclGroup? static_cast<NVariableDeclGroup*>(preStm->at(0)) : nullptr;
+	auto decl = declGroup && declGroup->getVars()->size() == 1? declGroup->getVars()->at(0) : nullptr;
+	auto cond = stm->getCond() && stm->getCond()->id() == NodeId::NCompareOperator? static_cast<NCompareOperator*>(stm->getCond()) : nullptr;
+	auto postExp = stm->getPostExp();
+	auto post = postExp->size() == 1 && postExp->at(0)->id() == NodeId::NIncrement? static_cast<NIncrement*>(postExp->at(0)) : nullptr;
+	auto isLoopVar = [=](NExpression* exp) {
+		return exp->id() == NodeId::NBaseVariable && static_cast<NBaseVariable*>(exp)->getName()->str == decl->getName()->str;
+	};
+	if (!decl || !decl->getInitExp() || !cond || cond->getOp() != '<' || !isLoopVar(cond->getLhs())
+			|| !post || post->getOp() != ParserBase::TT_INC || !isLoopVar(post->getVar())) {
+		context.addError("parallel for loop must have the form: for (int i = start; i < end; i++)", *attr);
+		return;
+	}
+
+	auto errors = context.errorCount();
+	context.pushLocalTable();
+	visit(preStm);
+
+	auto name = decl->getName()->str;
+	auto loopVar = context.loadSymbolCurr(name);
+	if (loopVar.empty()) {
+		context.popLocalTable();
+		return;
+	}
+	auto varType = loopVar[0].stype();
+	if (!varType->isInteger() || varType->isBool()) {
+		context.addError("parallel for loop variable must be an int type", decl->getName());
+		context.popLocalTable();
+		return;
+	}
+
+	auto int64Ty = SType::getInt(context, 64);
+	auto start = Inst::Load(context, loopVar[0]);
+	auto end = CGNExpression::run(context, cond->getRhs());
+	if (!end || Inst::CastTo(context, *cond->getRhs(), end, varType)
+			|| Inst::CastTo(context, decl->getName(), start, int64Ty) || Inst::CastTo(context, *cond->getRhs(), end, int64Ty)) {
+		context.popLocalTable();
+		return;
+	}
+
+	// placeholders for the range, which become parameters of the outlined loop
+	auto zero = ConstantInt::get(*int64Ty, 0);
+	auto lo = BinaryOperator::CreateAdd(start, zero, "lo", context.currBlock());
+	auto hi = BinaryOperator::CreateAdd(end, zero, "hi", context.currBlock());
+
+	auto regionBlock = context.createBlock();
+	auto condBlock = context.createBlock();
+	auto bodyBlock = context.createRedoBlock();
+	auto postBlock = context.createContinueBlock();
+	auto endBlock = context.createBreakBlock();
+	context.IB().CreateBr(regionBlock);
+
+	// each chunk has its own copy of the loop variable
+	context.pushBlock(regionBlock);
+	context.pushLocalTable();
+	auto chunkVar = RValue(Inst::Alloca(context, varType, name), varType);
+	context.storeLocalSymbol(chunkVar, name);
+	RValue loVal(lo, int64Ty);
+	Inst::CastTo(context, decl->getName(), loVal, varType);
+	context.IB().CreateStore(loVal, chunkVar);
+	context.IB().CreateBr(condBlock);
+
+	context.pushBlock(condBlock);
+	auto idx = Inst::Load(context, chunkVar);
+	Inst::CastTo(context, decl->getName(), idx, int64Ty);
+	auto inRange = varType->isUnsigned()? context.IB().CreateICmpULT(idx, hi) : context.IB().CreateICmpSLT(idx, hi);
+	context.IB().CreateCondBr(inRange, bodyBlock, endBlock);
+
+	context.pushBlock(bodyBlock);
+	visit(stm->getBody());
+	context.IB().CreateBr(postBlock);
+
+	context.pushBlock(postBlock);
+	CGNExpression::run(context, post);
+	context.popLocalTable();
+	context.IB().CreateBr(condBlock);
+
+	SmallVector<BasicBlock*, 8> region;
+	for (auto block = regionBlock->getIterator(); &*block != context.currBlock(); block++)
+		region.push_back(&*block);
+	region.push_back(context.currBlock());
+
+	context.pushBlock(endBlock);
+	context.popLocalTable();
+	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE | BranchType::REDO);
+
+	if (errors == context.errorCount())
+		outlineParallelFor(attr, region, condBlock, lo, hi, start, end);
+}
+
 void CGNStatement::visitNForStatement(NForStatement* stm)
 {
+	auto parallel = NAttributeList::find(stm->getAttrs(), "parallel");
+	if (parallel) {
+		visitParallelFor(stm, parallel);
+		return;
+	}
+
 	auto condBlock = context.createBlock();
 	auto bodyBlock = context.createRedoBlock();
 	auto postBlock = context.createContinueBlock();
@@ -407,7 +1050,7 @@ void CGNStatement::visitNForStatement(NForStatement* stm)
 	context.pushLocalTable();
 
 	visit(stm->getPreStm());
-	context.IB().CreateBr(condBlock);
+	auto entry = context.IB().CreateBr(condBlock);
 
 	context.pushBlock(condBlock);
 	Inst::Branch(bodyBlock, endBlock, stm->getCond(), context);
@@ -422,6 +1065,72 @@ void CGNStatement::visitNForStatement(NForStatement* stm)
 	context.popLocalTable();
 
 	context.IB().CreateBr(condBlock);
+	setLoopMetadata(stm, condBlock, entry);
+	context.pushBlock(endBlock);
+
+	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE | BranchType::REDO);
+}
+
+void CGNStatement::visitNForEachStatement(NForEachStatement* stm)
+{
+	auto seq = CGNExpression::run(context, stm->getCond());
+	if (!seq)
+		return;
+
+	// arrays and pointers to arrays are iterated as a slice of the whole array
+	auto seqType = seq.stype();
+	if (!seqType->isSlice()) {
+		auto arrType = seqType->isPointer()? seqType->subType() : seqType;
+		if (!arrType->isArray()) {
+			context.addError("for each requires an array or slice, found: " + seqType->str(context), *stm->getCond());
+			return;
+		} else if (Inst::CastTo(context, *stm->getCond(), seq, SType::getSlice(context, arrType->subType()))) {
+			return;
+		}
+	}
+
+	auto condBlock = context.createBlock();
+	auto bodyBlock = context.createRedoBlock();
+	auto postBlock = context.createContinueBlock();
+	auto endBlock = context.createBreakBlock();
+
+	context.pushLocalTable();
+
+	// the slice and index are hidden locals, so the element variable is
+	// declared from seq[idx] like any other variable
+	auto name = stm->getName();
+	auto int64Ty = SType::getInt(context, 64);
+	RValue seqVar(Inst::EntryAlloca(context, seq.stype()), seq.stype());
+	RValue idxVar(Inst::EntryAlloca(context, int64Ty), int64Ty);
+	context.IB().CreateStore(seq, seqVar);
+	context.IB().CreateStore(RValue::getZero(context, int64Ty), idxVar);
+	context.storeLocalSymbol(seqVar, "#seq");
+	context.storeLocalSymbol(idxVar, "#idx");
+	auto entry = context.IB().CreateBr(condBlock);
+
+	context.pushBlock(condBlock);
+	auto idx = context.IB().CreateLoad(*int64Ty, idxVar);
+	auto inRange = context.IB().CreateICmpULT(idx, Inst::SliceLen(context, seqVar));
+	context.IB().CreateCondBr(inRange, bodyBlock, endBlock);
+
+	context.pushBlock(bodyBlock);
+	context.pushLocalTable();
+	auto element = new NArrayVariable(new NBaseVariable(new Token(*name, "#seq")), new Token(*name, "["), new NBaseVariable(new Token(*name, "#idx")));
+	uPtr<NVariableDecl> decl(new NVariableDecl(name->copy(), element));
+	decl->setDataType(stm->getType());
+	visit(decl.get());
+	visit(stm->getBody());
+	context.popLocalTable();
+	context.IB().CreateBr(postBlock);
+
+	context.pushBlock(postBlock);
+	auto next = context.IB().CreateAdd(context.IB().CreateLoad(*int64Ty, idxVar), RValue::getNumVal(context, int64Ty), "", true, true);
+	context.IB().CreateStore(next, idxVar);
+
+	context.popLocalTable();
+
+	context.IB().CreateBr(condBlock);
+	setLoopMetadata(stm, condBlock, entry);
 	context.pushBlock(endBlock);
 
 	context.popLoopBranchBlocks(BranchType::BREAK | BranchType::CONTINUE | BranchType::REDO);
@@ -433,21 +1142,45 @@ void CGNStatement::visitNIfStatement(NIfStatement* stm)
 	auto elseBlock = context.createBlock();
 	auto endBlock = stm->getElseBody()? context.createBlock() : elseBlock;
 
+	MDNode* weights = nullptr;
+	auto likely = Builder::getLikelyAttr(context, stm->getAttrs());
+	if (likely > 0)
+		weights = MDBuilder(context).createBranchWeights(LIKELY_WEIGHT, UNLIKELY_WEIGHT);
+	else if (likely < 0)
+		weights = MDBuilder(context).createBranchWeights(UNLIKELY_WEIGHT, LIKELY_WEIGHT);
+
 	context.pushLocalTable();
 
-	Inst::Branch(ifBlock, elseBlock, stm->getCond(), context);
+	auto cond = Inst::Branch(ifBlock, elseBlock, stm->getCond(), context, weights);
 
-	context.pushBlock(ifBlock);
-	visit(stm->getBody());
-	context.popLocalTable();
-	context.IB().CreateBr(endBlock);
+	// a condition on template values is constant for each instance,
+	// so the dead branch is never generated
+	auto constCond = context.inTemplate() && cond? dyn_cast<ConstantInt>(cond.value()) : nullptr;
+	if (constCond) {
+		context.currBlock()->getTerminator()->eraseFromParent();
+		context.IB().CreateBr(constCond->isOne()? ifBlock : elseBlock);
+	}
 
-	context.pushBlock(elseBlock);
-	if (stm->getElseBody()) {
-		context.pushLocalTable();
-		visit(stm->getElseBody());
+	if (!constCond || constCond->isOne()) {
+		context.pushBlock(ifBlock);
+		visit(stm->getBody());
 		context.popLocalTable();
 		context.IB().CreateBr(endBlock);
+	} else {
+		context.popLocalTable();
+		ifBlock->eraseFromParent();
+	}
+
+	if (stm->getElseBody()) {
+		if (!constCond || constCond->isZero()) {
+			context.pushBlock(elseBlock);
+			context.pushLocalTable();
+			visit(stm->getElseBody());
+			context.popLocalTable();
+			context.IB().CreateBr(endBlock);
+		} else {
+			elseBlock->eraseFromParent();
+		}
 	}
 	context.pushBlock(endBlock);
 }
@@ -548,15 +1281,35 @@ void CGNStatement::visitNDeleteStatement(NDeleteStatement* stm)
 		return;
 	}
 
+	auto allocator = Builder::getAllocator(context, stm->getAllocator());
+	if (!allocator && stm->getAllocator())
+		return;
+
 	Inst::CallDestructor(context, ptr, arrSize, varTok);
 
+	if (allocator) {
+		VecRValue freeArgs{ptr, Builder::getAllocSize(context, ptr.stype()->subType(), arrSize)};
+		Builder::CallAllocator(context, allocator, varTok, "free", freeArgs);
+		return;
+	}
+
 	auto func = Builder::getBuiltinFunc(context, varTok, BuiltinFuncType::Free);
 	auto bitCast = context.IB().CreateBitCast(ptr, *func.getParam(0));
 
 	if (context.config().count("print-debug"))
 		Builder::AddDebugPrint(context, varTok, "[DEBUG] free(%i) at " + varTok->getLoc(), {bitCast});
 
-	context.IB().CreateCall(func.funcType(), func.value(), {bitCast});
+	// pointers to sized arrays can be cast to smaller arrays, so only an
+	// explicit array size gives the exact allocation size
+	auto type = ptr.stype()->subType();
+	auto hasSize = context.config().count("sized-free") && !type->isUnsized() && (!type->isArray() || (arrSize && arrSize.stype()->isInteger()));
+	if (!hasSize) {
+		context.IB().CreateCall(func.funcType(), func.value(), {bitCast});
+		return;
+	}
+
+	auto size = Builder::getAllocSize(context, type, arrSize);
+	Builder::CallSizedFree(context, varTok, RValue(bitCast, func.getParam(0)), size, SType::userAlign(context, type));
 }
 
 void CGNStatement::visitNDestructorCall(NDestructorCall* stm)
@@ -570,7 +1323,7 @@ void CGNStatement::visitNDestructorCall(NDestructorCall* stm)
 	auto type = value.stype();
 	while (true) {
 		auto sub = type->subType();
-		if (sub->isClass()) {
+		if (sub->isClass() || (sub->isArray() && sub->subType()->isClass())) {
 			break;
 		} else if (sub->isPointer()) {
 			value = Inst::Deref(context, value);
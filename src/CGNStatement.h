@@ -58,16 +58,40 @@ class CGNStatement
 
 	void visitNClassDeclaration(NClassDeclaration* stm);
 
+	NExpression* getCopySource(NExpression* exp);
+
+	bool isDyingLocal(NExpression* exp);
+
+	void setMustTail(NReturnStatement* stm, const RValue& returnVal, ReturnInst* ret);
+
 	void visitNReturnStatement(NReturnStatement* stm);
 
+	bool storePromise(NExpression* exp, Token* token);
+
+	void visitAsyncReturn(NReturnStatement* stm);
+
+	void visitNYieldStatement(NYieldStatement* stm);
+
+	void visitNAwaitStatement(NAwaitStatement* stm);
+
+	void setLoopMetadata(NConditionStmt* stm, BasicBlock* header, Instruction* entry);
+
 	void visitNLoopStatement(NLoopStatement* stm);
 
 	void visitNWhileStatement(NWhileStatement* stm);
 
+	RValue stringSwitchIndex(NSwitchStatement* stm, RValue switchValue);
+
 	void visitNSwitchStatement(NSwitchStatement* stm);
 
+	bool outlineParallelFor(NAttribute* attr, SmallVector<BasicBlock*, 8>& region, BasicBlock* condBlock, Instruction* lo, Instruction* hi, Value* start, Value* end);
+
+	void visitParallelFor(NForStatement* stm, NAttribute* attr);
+
 	void visitNForStatement(NForStatement* stm);
 
+	void visitNForEachStatement(NForEachStatement* stm);
+
 	void visitNIfStatement(NIfStatement* stm);
 
 	void visitNLabelStatement(NLabelStatement* stm);
@@ -32,6 +32,7 @@ RValue CGNVariable::visit(NVariable* type)
 	VISIT_CASE_RETURN(NFunctionCall, type)
 	VISIT_CASE_RETURN(NMemberFunctionCall, type)
 	VISIT_CASE_RETURN(NMemberVariable, type)
+	VISIT_CASE_RETURN(NSliceVariable, type)
 	default:
 		context.addError("NodeId::" + to_string(static_cast<int>(type->id())) + " unrecognized in CGNVariable", *type);
 		return RValue();
@@ -92,13 +93,18 @@ RValue CGNVariable::visitNBaseVariable(NBaseVariable* baseVar)
 			context.addError("variable " + varName + " not declared", *baseVar);
 		}
 		return {};
+	} else if (userVar->isConstValue()) {
+		// template parameter bound to a value
+		auto valType = userVar->subType();
+		auto value = ConstantInt::get(*valType, userVar->constValue(), !valType->isUnsigned());
+		return RValue(value, SType::getConst(context, valType));
 	}
 	return RValue::getUndef(userVar);
 }
 
-RValue CGNVariable::visitNArrayVariable(NArrayVariable* nArrVar)
+RValue CGNVariable::loadArray(NArrayVariable* nArrVar, RValue& indexVal)
 {
-	auto indexVal = CGNExpression::run(context, nArrVar->getIndex());
+	indexVal = CGNExpression::run(context, nArrVar->getIndex());
 
 	if (!indexVal) {
 		return indexVal;
@@ -112,12 +118,40 @@ RValue CGNVariable::visitNArrayVariable(NArrayVariable* nArrVar)
 		return var;
 	var = Inst::Deref(context, var, true);
 
+	RValue len;
+	auto check = Inst::BoundsCheckEnabled(context);
+	if (var.stype()->isSlice()) {
+		if (check)
+			len = Inst::SliceLen(context, var);
+		var = Inst::SliceData(context, var);
+	}
+
 	if (!var.stype()->isSequence()) {
 		context.addError(var.stype()->str(context) + " is not an array or vec", *nArrVar->getArrayVar());
 		return RValue();
 	}
 	Inst::CastTo(context, *nArrVar->getIndex(), indexVal, SType::getInt(context, 64));
 
+	if (check && !len && var.stype()->size())
+		len = RValue::getNumVal(context, var.stype()->size(), 64);
+	if (len) {
+		// unsigned compare also catches negative indexes
+		Inst::BoundsCheck(context, context.IB().CreateICmpULT(indexVal, len));
+	}
+	return var;
+}
+
+RValue CGNVariable::visitNArrayVariable(NArrayVariable* nArrVar)
+{
+	RValue indexVal;
+	auto var = loadArray(nArrVar, indexVal);
+	if (!var) {
+		return var;
+	} else if (var.stype()->isSoa()) {
+		context.addError("soa array elements only support member access", *nArrVar);
+		return RValue();
+	}
+
 	vector<Value*> indexes;
 	indexes.push_back(RValue::getZero(context, SType::getInt(context, 32)));
 	indexes.push_back(indexVal);
@@ -125,6 +159,72 @@ RValue CGNVariable::visitNArrayVariable(NArrayVariable* nArrVar)
 	return Inst::GetElementPtr(context, var, indexes, var.stype()->subType());
 }
 
+RValue CGNVariable::loadSliceIndex(NExpression* index)
+{
+	auto indexVal = CGNExpression::run(context, index);
+	if (!indexVal) {
+		return indexVal;
+	} else if (!(indexVal.stype()->isNumeric() || indexVal.stype()->isEnum())) {
+		context.addError("slice index is not able to be cast to an int", *index);
+		return RValue();
+	}
+	Inst::CastTo(context, *index, indexVal, SType::getInt(context, 64));
+	return indexVal;
+}
+
+RValue CGNVariable::visitNSliceVariable(NSliceVariable* nVar)
+{
+	auto var = visit(nVar->getArrayVar());
+	if (!var)
+		return var;
+	var = Inst::Deref(context, var, true);
+
+	RValue len;
+	auto type = var.stype();
+	if (type->isSlice()) {
+		auto slice = Inst::Load(context, var);
+		len = RValue(context.IB().CreateExtractValue(slice, 1), SType::getInt(context, 64));
+		var = Inst::SliceData(context, var);
+	} else if (type->isArray() && !type->isSoa()) {
+		if (type->size())
+			len = RValue::getNumVal(context, type->size(), 64);
+	} else {
+		context.addError(type->str(context) + " is not an array or slice", *nVar->getArrayVar());
+		return RValue();
+	}
+
+	auto start = nVar->getStart() ? loadSliceIndex(nVar->getStart()) : RValue::getNumVal(context, 0, 64);
+	RValue end;
+	if (nVar->getEnd()) {
+		end = loadSliceIndex(nVar->getEnd());
+	} else if (!len) {
+		context.addError("slice of unsized array requires an end index", *nVar);
+		return RValue();
+	} else {
+		end = len;
+	}
+	if (!start || !end)
+		return RValue();
+
+	if (Inst::BoundsCheckEnabled(context)) {
+		auto inRange = context.IB().CreateICmpULE(start, end);
+		if (len)
+			inRange = context.IB().CreateAnd(inRange, context.IB().CreateICmpULE(end, len));
+		Inst::BoundsCheck(context, inRange);
+	}
+
+	vector<Value*> indexes;
+	indexes.push_back(RValue::getZero(context, SType::getInt(context, 32)));
+	indexes.push_back(start);
+	auto elPtr = context.IB().CreateGEP(*var.stype(), var, indexes);
+
+	auto sliceLen = Inst::BinaryOp('-', *nVar, end, start, context);
+	auto slice = Inst::MakeSlice(context, elPtr, sliceLen, SType::getSlice(context, var.stype()->subType()));
+	auto tmp = Inst::EntryAlloca(context, slice.stype());
+	context.IB().CreateStore(slice, tmp);
+	return RValue(tmp, slice.stype());
+}
+
 RValue CGNVariable::visitNArrowOperator(NArrowOperator* exp)
 {
 	auto name = exp->getName()->str;
@@ -147,7 +247,26 @@ RValue CGNVariable::visitNArrowOperator(NArrowOperator* exp)
 
 RValue CGNVariable::visitNMemberVariable(NMemberVariable* memVar)
 {
-	auto var = visit(memVar->getBaseVar());
+	auto baseVar = memVar->getBaseVar();
+	if (baseVar->id() == NodeId::NArrayVariable) {
+		// a[i].x is stored at a.x[i] for soa arrays
+		RValue indexVal;
+		auto arrVar = static_cast<NArrayVariable*>(baseVar);
+		auto var = loadArray(arrVar, indexVal);
+		if (!var) {
+			return var;
+		} else if (var.stype()->isSoa()) {
+			return Inst::LoadSoaMember(context, var, indexVal, memVar->getMemberName());
+		}
+
+		vector<Value*> indexes;
+		indexes.push_back(RValue::getZero(context, SType::getInt(context, 32)));
+		indexes.push_back(indexVal);
+		var = Inst::GetElementPtr(context, var, indexes, var.stype()->subType());
+		return Inst::LoadMemberVar(context, var, *baseVar, memVar->getMemberName());
+	}
+
+	auto var = visit(baseVar);
 	if (!var)
 		return RValue();
 
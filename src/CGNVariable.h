@@ -24,10 +24,16 @@ class CGNVariable
 	explicit CGNVariable(CodeContext& context)
 	: context(context) {}
 
+	RValue loadArray(NArrayVariable* nArrVar, RValue& indexVal);
+
 	RValue visitNBaseVariable(NBaseVariable* baseVar);
 
 	RValue visitNArrayVariable(NArrayVariable* nArrVar);
 
+	RValue loadSliceIndex(NExpression* index);
+
+	RValue visitNSliceVariable(NSliceVariable* nVar);
+
 	RValue visitNArrowOperator(NArrowOperator* exp);
 
 	RValue visitNMemberVariable(NMemberVariable* memVar);
@@ -85,6 +85,17 @@ bool GlobalContext::fileLoaded(const path& filename)
 	return allFiles.find(filename) != allFiles.end();
 }
 
+void GlobalContext::initDebugInfo(const path& filename, bool lineTablesOnly)
+{
+	debugInfo.reset(new DebugInfo(*module, filename.string(), lineTablesOnly));
+}
+
+void GlobalContext::finalizeDebugInfo()
+{
+	if (debugInfo)
+		debugInfo->finalize();
+}
+
 void CodeContext::validateFunction()
 {
 	for (const auto& item : labelBlocks) {
@@ -192,6 +203,36 @@ VecRValue CodeContext::loadSymbolGlobal(const string& name) const
 	return globalCtx.globalTable.loadSymbol(name);
 }
 
+RValue CodeContext::getAllocator()
+{
+	globalCtx.allocatorUsed = true;
+	return globalCtx.allocator;
+}
+
+void CodeContext::addGlobalInit(GlobalVariable* var, Token* token)
+{
+	globalCtx.globalInits.push_back(make_tuple(var, currFunc.funcValue(), *token));
+}
+
+vector<tuple<GlobalVariable*, Function*, Token>>& CodeContext::getGlobalInits()
+{
+	return globalCtx.globalInits;
+}
+
+DebugInfo* CodeContext::getDebugInfo() const
+{
+	return globalCtx.debugInfo.get();
+}
+
+bool CodeContext::setAllocator(const RValue& alloc)
+{
+	if (globalCtx.allocatorUsed)
+		return true;
+	globalCtx.allocator = alloc;
+	globalCtx.allocatorUsed = true;
+	return false;
+}
+
 NTemplatedDeclaration* CodeContext::getTemplate(const string& name)
 {
 	return globalCtx.typeManager.getTemplateType(name);
@@ -202,6 +243,17 @@ void CodeContext::storeTemplate(const string& name, NTemplatedDeclaration* decl)
 	globalCtx.typeManager.storeTemplate(name, decl);
 }
 
+NFunctionDeclaration* CodeContext::getFuncTemplate(const string& name)
+{
+	auto item = globalCtx.funcTemplates.find(name);
+	return item != globalCtx.funcTemplates.end()? item->second.get() : nullptr;
+}
+
+void CodeContext::storeFuncTemplate(const string& name, NFunctionDeclaration* decl)
+{
+	globalCtx.funcTemplates[name] = uPtr<NFunctionDeclaration>(decl->copy());
+}
+
 bool CodeContext::inTemplate() const
 {
 	return !templateArgs.empty();
@@ -320,10 +372,21 @@ void CodeContext::endFuncBlock()
 	breakBlocks.clear();
 	redoBlocks.clear();
 	labelBlocks.clear();
+	coroutine = CoroutineState();
 	irBuilder->ClearInsertionPoint();
 	currFunc = SFunction();
 }
 
+CoroutineState* CodeContext::getCoroutine()
+{
+	return coroutine.handle? &coroutine : nullptr;
+}
+
+void CodeContext::setCoroutine(const CoroutineState& state)
+{
+	coroutine = state;
+}
+
 void CodeContext::startTmpFunction(Token* prefix)
 {
 	auto name = prefix->str + "_" + to_string(prefix->line) + to_string(prefix->col);
@@ -334,12 +397,19 @@ void CodeContext::startTmpFunction(Token* prefix)
 
 	irBuilder->SetInsertPoint(block);
 	currFunc = function;
+	tmpFunction = true;
 }
 
 void CodeContext::endTmpFunction()
 {
 	currFunc.funcValue()->removeFromParent();
 	irBuilder->ClearInsertionPoint();
+	tmpFunction = false;
+}
+
+bool CodeContext::inTmpFunction() const
+{
+	return tmpFunction;
 }
 
 void CodeContext::pushBlock(BasicBlock* block)
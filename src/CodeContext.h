@@ -22,6 +22,7 @@
 #include <llvm/IR/Module.h>
 #include <llvm/IR/IRBuilder.h>
 #include "Value.h"
+#include "DebugInfo.h"
 
 using namespace boost::filesystem;
 using namespace boost::program_options;
@@ -40,6 +41,18 @@ struct LabelBlock
 
 using LabelBlockPtr = uPtr<LabelBlock>;
 
+struct CoroutineState
+{
+	// declared return type, the promise holds yielded/returned values
+	SType* yieldType = nullptr;
+	RValue promise;
+	Value* id = nullptr;
+	Value* handle = nullptr;
+	BasicBlock* finalBlock = nullptr;
+	BasicBlock* cleanupBlock = nullptr;
+	BasicBlock* suspendBlock = nullptr;
+};
+
 class ScopeTable
 {
 	map<string, VecRValue> table;
@@ -62,11 +75,16 @@ class GlobalContext
 
 	vector<pair<Token,string>> errors;
 	list<uPtr<NAttributeList>> attrs;
+	map<string, uPtr<NFunctionDeclaration>> funcTemplates;
 
 	set<path> allFiles;
 	vector<path> filesStack;
 
 	ScopeTable globalTable;
+	RValue allocator;
+	bool allocatorUsed = false;
+	vector<tuple<GlobalVariable*, Function*, Token>> globalInits;
+	uPtr<DebugInfo> debugInfo;
 
 public:
 	explicit GlobalContext(Module* module)
@@ -86,6 +104,10 @@ public:
 	void pushFile(const path& filename);
 
 	bool fileLoaded(const path& filename);
+
+	void initDebugInfo(const path& filename, bool lineTablesOnly);
+
+	void finalizeDebugInfo();
 };
 
 class CodeContext
@@ -101,6 +123,7 @@ class CodeContext
 
 	shared_ptr<IRBuilder<>> irBuilder;
 	SFunction currFunc;
+	bool tmpFunction = false;
 	STemplatedType* thisType = nullptr;
 	SClassType* currClass = nullptr;
 	vector<ScopeTable> localTable;
@@ -110,6 +133,7 @@ class CodeContext
 	BlockCountVec breakBlocks;
 	BlockCountVec redoBlocks;
 	map<string, LabelBlockPtr> labelBlocks;
+	CoroutineState coroutine;
 
 	void validateFunction();
 
@@ -159,6 +183,31 @@ public:
 
 	VecRValue loadSymbolGlobal(const string& name) const;
 
+	/**
+	 * @return the default allocator, null when using malloc and free.
+	 * Marks the default as used so it can't be changed afterwards.
+	 */
+	RValue getAllocator();
+
+	/**
+	 * Returns true on error, when a default allocator was already set
+	 * or a previous new or delete already used malloc and free.
+	 */
+	bool setAllocator(const RValue& alloc);
+
+	/**
+	 * Adds the current temporary function as the initializer of var, to
+	 * be evaluated once all functions are generated
+	 */
+	void addGlobalInit(GlobalVariable* var, Token* token);
+
+	vector<tuple<GlobalVariable*, Function*, Token>>& getGlobalInits();
+
+	/**
+	 * @return the debug info builder, null when debug info is disabled
+	 */
+	DebugInfo* getDebugInfo() const;
+
 	/**
 	 * local context functions
 	 **/
@@ -167,6 +216,10 @@ public:
 
 	void storeTemplate(const string& name, NTemplatedDeclaration* decl);
 
+	NFunctionDeclaration* getFuncTemplate(const string& name);
+
+	void storeFuncTemplate(const string& name, NFunctionDeclaration* decl);
+
 	bool inTemplate() const;
 
 	SType* getTemplateArg(const string& name);
@@ -203,10 +256,22 @@ public:
 
 	void endFuncBlock();
 
+	/**
+	 * @return the coroutine state of the current async function or null
+	 */
+	CoroutineState* getCoroutine();
+
+	void setCoroutine(const CoroutineState& state);
+
 	void startTmpFunction(Token* prefix);
 
 	void endTmpFunction();
 
+	/**
+	 * @return true while generating global or enum initializer code
+	 */
+	bool inTmpFunction() const;
+
 	void pushBlock(BasicBlock* block);
 
 	void popLoopBranchBlocks(int type);
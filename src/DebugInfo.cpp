@@ -0,0 +1,204 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2017, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <llvm/BinaryFormat/Dwarf.h>
+#include "CodeContext.h"
+#include "DebugInfo.h"
+
+DebugInfo::DebugInfo(Module& module, const string& filename, bool lineTablesOnly)
+: builder(module), unit(nullptr), lineTablesOnly(lineTablesOnly)
+{
+	auto kind = lineTablesOnly? DICompileUnit::LineTablesOnly : DICompileUnit::FullDebug;
+	unit = builder.createCompileUnit(dwarf::DW_LANG_C_plus_plus, getFile(filename), "saphyr", false, "", 0, "", kind);
+
+	module.addModuleFlag(Module::Warning, "Debug Info Version", DEBUG_METADATA_VERSION);
+	module.addModuleFlag(Module::Warning, "Dwarf Version", 4);
+}
+
+DIFile* DebugInfo::getFile(const string& filename)
+{
+	// generated tokens don't have a file
+	if (filename.empty())
+		return unit->getFile();
+
+	auto& file = files[filename];
+	if (!file) {
+		auto filePath = boost::filesystem::absolute(filename);
+		file = builder.createFile(filePath.filename().string(), filePath.parent_path().string());
+	}
+	return file;
+}
+
+DISubprogram* DebugInfo::getScope(CodeContext& context)
+{
+	auto func = context.currFunction();
+	return func? func.funcValue()->getSubprogram() : nullptr;
+}
+
+void DebugInfo::startFunction(CodeContext& context, SFunction function, Token* name)
+{
+	auto file = getFile(name->filename);
+	auto funcType = lineTablesOnly?
+		builder.createSubroutineType(builder.getOrCreateTypeArray({})) :
+		getFunctionType(context, function.funcSType());
+	auto subprogram = builder.createFunction(file, name->str, function.name(), file, name->line,
+		funcType, name->line, DINode::FlagPrototyped, DISubprogram::SPFlagDefinition);
+	function.funcValue()->setSubprogram(subprogram);
+
+	// calls in a function with debug info must have a location
+	setLocation(context, name);
+}
+
+void DebugInfo::endFunction(CodeContext& context)
+{
+	auto subprogram = getScope(context);
+	if (subprogram)
+		builder.finalizeSubprogram(subprogram);
+	context.IB().SetCurrentDebugLocation(DebugLoc());
+}
+
+void DebugInfo::setLocation(CodeContext& context, Token* token)
+{
+	auto subprogram = getScope(context);
+	if (!subprogram || !token)
+		return;
+	context.IB().SetCurrentDebugLocation(DILocation::get(context, token->line, token->col, subprogram));
+}
+
+void DebugInfo::declareVariable(CodeContext& context, Value* alloc, SType* type, Token* name, unsigned argNo)
+{
+	auto subprogram = getScope(context);
+	if (lineTablesOnly || !subprogram)
+		return;
+
+	auto file = getFile(name->filename);
+	auto diType = getType(context, type);
+	auto var = argNo?
+		builder.createParameterVariable(subprogram, name->str, argNo, file, name->line, diType) :
+		builder.createAutoVariable(subprogram, name->str, file, name->line, diType);
+	auto loc = DILocation::get(context, name->line, name->col, subprogram);
+	builder.insertDeclare(alloc, var, builder.createExpression(), loc, context.IB().GetInsertBlock());
+}
+
+DIType* DebugInfo::getType(CodeContext& context, SType* type)
+{
+	auto item = types.find(type);
+	if (item != types.end())
+		return item->second;
+
+	auto ptrSize = context.getModule()->getDataLayout().getPointerSizeInBits();
+	DIType* diType = nullptr;
+	if (type->isConst()) {
+		diType = builder.createQualifiedType(dwarf::DW_TAG_const_type, getType(context, SType::getMutable(context, type)));
+	} else if (type->isStruct() || type->isUnion() || type->isSlice() || type->isSoa()) {
+		return getStructType(context, type);
+	} else if (type->isEnum()) {
+		diType = getType(context, type->subType());
+	} else if (type->isBool()) {
+		diType = builder.createBasicType("bool", 8, dwarf::DW_ATE_boolean);
+	} else if (type->isInteger()) {
+		auto encoding = type->isUnsigned()? dwarf::DW_ATE_unsigned : dwarf::DW_ATE_signed;
+		diType = builder.createBasicType(type->str(context), type->size(), encoding);
+	} else if (type->isFloating()) {
+		diType = builder.createBasicType(type->str(context), SType::allocSize(context, type) * 8, dwarf::DW_ATE_float);
+	} else if (type->isPointer()) {
+		diType = builder.createPointerType(getType(context, type->subType()), ptrSize);
+	} else if (type->isReference()) {
+		diType = builder.createReferenceType(dwarf::DW_TAG_reference_type, getType(context, type->subType()), ptrSize);
+	} else if (type->isSequence()) {
+		auto elType = getType(context, type->subType());
+		auto range = builder.getOrCreateArray({builder.getOrCreateSubrange(0, type->size())});
+		auto bits = SType::allocSize(context, type) * 8;
+		auto align = SType::allocAlign(context, type) * 8;
+		diType = type->isArray()?
+			builder.createArrayType(bits, align, elType, range) :
+			builder.createVectorType(bits, align, elType, range);
+	} else if (type->isFunction()) {
+		diType = getFunctionType(context, static_cast<SFunctionType*>(type));
+	}
+	// void, auto and opaque types have no description
+	types[type] = diType;
+	return diType;
+}
+
+DIType* DebugInfo::getStructType(CodeContext& context, SType* type)
+{
+	auto file = unit->getFile();
+	auto name = type->str(context);
+	if (type->isOpaque()) {
+		auto decl = builder.createForwardDecl(dwarf::DW_TAG_structure_type, name, unit, file, 0);
+		types[type] = decl;
+		return decl;
+	}
+
+	auto bits = SType::allocSize(context, type) * 8;
+	auto align = SType::allocAlign(context, type) * 8;
+	auto composite = type->isUnion()?
+		builder.createUnionType(unit, name, file, 0, bits, align, DINode::FlagZero, DINodeArray()) :
+		builder.createStructType(unit, name, file, 0, bits, align, DINode::FlagZero, nullptr, DINodeArray());
+	// stored before the members are created so self referencing types end
+	types[type] = composite;
+
+	// union members share storage and aren't stored by index
+	vector<pair<int, pair<string, SType*>>> fields;
+	if (type->isSlice()) {
+		fields.push_back({0, {"ptr", SType::getPointer(context, SType::getArray(context, type->subType(), 0))}});
+		fields.push_back({1, {"size", SType::getInt(context, 64)}});
+	} else if (type->isStruct() || type->isSoa()) {
+		// a soa array is stored as a struct with an array for each member
+		auto structType = static_cast<SStructType*>(type->isSoa()? type->subType() : type);
+		for (const auto& item : *structType) {
+			for (const auto& member : item.second) {
+				if (member.second.isFunction())
+					continue;
+				auto memberType = member.second.stype();
+				if (type->isSoa())
+					memberType = SType::getArray(context, memberType, type->size());
+				fields.push_back({member.first, {item.first, memberType}});
+			}
+		}
+		std::sort(fields.begin(), fields.end(), [](const auto& lhs, const auto& rhs){ return lhs.first < rhs.first; });
+	}
+
+	vector<Metadata*> members;
+	auto layout = context.getModule()->getDataLayout().getStructLayout(cast<StructType>(type->type()));
+	for (const auto& field : fields) {
+		auto fieldType = field.second.second;
+		auto fieldBits = SType::allocSize(context, fieldType) * 8;
+		auto fieldAlign = SType::allocAlign(context, fieldType) * 8;
+		auto offset = layout->getElementOffsetInBits(field.first);
+		members.push_back(builder.createMemberType(composite, field.second.first, file, 0,
+			fieldBits, fieldAlign, offset, DINode::FlagZero, getType(context, fieldType)));
+	}
+	builder.replaceArrays(composite, builder.getOrCreateArray(members));
+	return composite;
+}
+
+DISubroutineType* DebugInfo::getFunctionType(CodeContext& context, SFunctionType* type)
+{
+	// the first type is the return type, null for void
+	vector<Metadata*> params;
+	params.push_back(getType(context, type->returnTy()));
+	for (size_t i = 0; i < type->numParams(); i++)
+		params.push_back(getType(context, type->getParam(i)));
+	return builder.createSubroutineType(builder.getOrCreateTypeArray(params));
+}
+
+void DebugInfo::finalize()
+{
+	builder.finalize();
+}
@@ -0,0 +1,72 @@
+/* Saphyr, a C++ style compiler using LLVM
+ * Copyright (C) 2009-2017, Justin Madru (justin.jdm64@gmail.com)
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef __DEBUG_INFO_H__
+#define __DEBUG_INFO_H__
+
+#include <map>
+#include <llvm/IR/DIBuilder.h>
+#include "Value.h"
+
+// forward declaration
+class CodeContext;
+
+class DebugInfo
+{
+	DIBuilder builder;
+	DICompileUnit* unit;
+	bool lineTablesOnly;
+
+	map<string, DIFile*> files;
+	map<SType*, DIType*> types;
+
+	DIFile* getFile(const string& filename);
+
+	DIType* getStructType(CodeContext& context, SType* type);
+
+	DISubroutineType* getFunctionType(CodeContext& context, SFunctionType* type);
+
+	static DISubprogram* getScope(CodeContext& context);
+
+public:
+	DebugInfo(Module& module, const string& filename, bool lineTablesOnly);
+
+	/**
+	 * creates the subprogram for a function and sets the location to
+	 * the function's name
+	 */
+	void startFunction(CodeContext& context, SFunction function, Token* name);
+
+	void endFunction(CodeContext& context);
+
+	/**
+	 * sets the location of the instructions created after this call,
+	 * does nothing outside of a function with debug info
+	 */
+	void setLocation(CodeContext& context, Token* token);
+
+	/**
+	 * describes a local variable or parameter (when argNo isn't 0)
+	 * stored in alloc, only used with full debug info
+	 */
+	void declareVariable(CodeContext& context, Value* alloc, SType* type, Token* name, unsigned argNo = 0);
+
+	DIType* getType(CodeContext& context, SType* type);
+
+	void finalize();
+};
+
+#endif
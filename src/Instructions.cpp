@@ -14,12 +14,17 @@
  * You should have received a copy of the GNU General Public License
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <llvm/IR/MDBuilder.h>
 #include "Instructions.h"
 #include "parserbase.h"
 #include "CGNDataType.h"
 #include "CGNVariable.h"
+#include "Builder.h"
 #include "CGNExpression.h"
 
+#define MIN_MEM_INTRINSIC_SIZE 64
+#define BOUNDS_OK_WEIGHT 2000
+
 void Inst::castError(CodeContext& context, const string& msg, SType* from, SType* to, Token* token)
 {
 	context.addError(msg + " ( " + from->str(context) + " to " + to->str(context) + " )", token);
@@ -48,6 +53,48 @@ bool Inst::CastMatch(CodeContext& context, Token* optToken, RValue& lhs, RValue&
 	return CastTo(context, optToken, lhs, toType, upcast) || CastTo(context, optToken, rhs, toType, upcast);
 }
 
+bool Inst::SliceCast(CodeContext& context, Token* token, RValue& value, SType* type)
+{
+	auto valueType = value.stype();
+	if (valueType->isSlice()) {
+		if (!SType::isConstEQ(context, type->subType(), valueType->subType())) {
+			castError(context, "Cannot cast slices of different types", valueType, type, token);
+			return true;
+		}
+		value = RValue(value.value(), type);
+		return false;
+	}
+
+	RValue arrPtr;
+	if (valueType->isArray()) {
+		arrPtr = PtrOfLoad(context, value);
+		if (!arrPtr) {
+			auto tmp = EntryAlloca(context, valueType);
+			context.IB().CreateStore(value, tmp);
+			arrPtr = RValue(tmp, SType::getPointer(context, valueType));
+		} else if (value.value()->use_empty()) {
+			// remove unused array load
+			dyn_cast<Instruction>(value.value())->eraseFromParent();
+		}
+	} else if (valueType->isPointer() && valueType->subType()->isArray()) {
+		arrPtr = value;
+	} else {
+		castError(context, "Cannot cast type to slice", valueType, type, token);
+		return true;
+	}
+
+	auto arrType = arrPtr.stype()->subType();
+	if (!SType::isConstEQ(context, type->subType(), arrType->subType()) || arrType->isSoa()) {
+		castError(context, "Cannot cast array to slice of different type", valueType, type, token);
+		return true;
+	} else if (!arrType->size()) {
+		castError(context, "Cannot cast unsized array to slice, use a subslice", valueType, type, token);
+		return true;
+	}
+	value = MakeSlice(context, arrPtr, RValue::getNumVal(context, arrType->size(), 64), type);
+	return false;
+}
+
 bool Inst::CastTo(CodeContext& context, Token* token, RValue& value, SType* type, bool upcast)
 {
 	if (!value)
@@ -64,6 +111,8 @@ bool Inst::CastTo(CodeContext& context, Token* token, RValue& value, SType* type
 	} else if (valueType->isVoid()) {
 		castError(context, "Cannot cast void type", valueType, type, token);
 		return true;
+	} else if (type->isSlice()) {
+		return SliceCast(context, token, value, type);
 	} else if (type->isComplex()) {
 		castError(context, "Cannot cast complex types", valueType, type, token);
 		return true;
@@ -78,6 +127,9 @@ bool Inst::CastTo(CodeContext& context, Token* token, RValue& value, SType* type
 			if (!SType::isConstEQ(context, type->subType()->subType(), valueType->subType()->subType())) {
 				castError(context, "Cannot cast array pointers of different types", valueType, type, token);
 				return true;
+			} else if ((type->subType()->isSoa() || valueType->subType()->isSoa()) && type->subType()->size() != valueType->subType()->size()) {
+				castError(context, "Cannot cast soa array pointers of different sizes", valueType, type, token);
+				return true;
 			} else if (type->subType()->size() > valueType->subType()->size()) {
 				context.addError("Pointers to arrays only allowed to cast to smaller arrays", token);
 				return true;
@@ -415,12 +467,12 @@ RValue Inst::BinaryOp(int type, Token* optToken, RValue lhs, RValue rhs, CodeCon
 	}
 }
 
-RValue Inst::Branch(BasicBlock* trueBlock, BasicBlock* falseBlock, NExpression* condExp, CodeContext& context)
+RValue Inst::Branch(BasicBlock* trueBlock, BasicBlock* falseBlock, NExpression* condExp, CodeContext& context, MDNode* weights)
 {
 	auto condValue = condExp? CGNExpression::run(context, condExp) : RValue::getNumVal(context, SType::getBool(context));
 	Token* token = condExp ? *condExp : static_cast<Token*>(nullptr);
 	CastTo(context, token, condValue, SType::getBool(context));
-	context.IB().CreateCondBr(condValue, trueBlock, falseBlock);
+	context.IB().CreateCondBr(condValue, trueBlock, falseBlock, weights);
 	return condValue;
 }
 
@@ -469,6 +521,8 @@ RValue Inst::Load(CodeContext& context, RValue value)
 		return RValue(value.value(), SType::getPointer(context, value.stype()));
 	else if (value.type() == value.stype()->type())
 		return value;
+	else if (value.isAtomic())
+		return Builder::LoadAtomic(context, value);
 
 	return RValue(context.IB().CreateLoad(value), value.stype());
 }
@@ -560,12 +614,14 @@ RValue Inst::LenOp(CodeContext& context, NArrowOperator* op)
 	}
 
 	const SType* dtype = nullptr;
+	RValue value;
 	switch (op->getType()) {
 	case NArrowOperator::DATA:
 		dtype = CGNDataType::run(context, op->getDataType());
 		break;
 	case NArrowOperator::EXP:
-		dtype = CGNExpression::run(context, op->getExp()).stype();
+		value = CGNExpression::run(context, op->getExp());
+		dtype = value.stype();
 		break;
 	default:
 		// shouldn't happen
@@ -577,6 +633,8 @@ RValue Inst::LenOp(CodeContext& context, NArrowOperator* op)
 
 	if (dtype->isArray() || dtype->isEnum()) {
 		return RValue::getNumVal(context, dtype->size());
+	} else if (dtype->isSlice() && value) {
+		return RValue(context.IB().CreateExtractValue(value, 1), SType::getInt(context, 64));
 	}
 
 	context.addError("len operator invalid for " + dtype->str(context) + " type", op->getName());
@@ -616,7 +674,7 @@ RValue Inst::Copy(CodeContext& context, NArrowOperator* op)
 RValue Inst::Copy(CodeContext& context, RValue value, Token* token)
 {
 	Token name(*token, "tmp_" + to_string(token->line) + to_string(token->col));
-	auto copy = RValue(context.IB().CreateAlloca(value.type(), nullptr, name.str), value.stype());
+	auto copy = RValue(Alloca(context, value.stype(), name.str), value.stype());
 	copy.setMove(true);
 	context.storeLocalSymbol(copy, name.str);
 
@@ -698,6 +756,11 @@ RValue Inst::CallFunction(CodeContext& context, VecSFunc& funcs, Token* name, Ve
 		func = paramMatch[0];
 	}
 
+	if (context.inTmpFunction() && !NAttributeList::find(func.attrs(), "const")) {
+		context.addError("only const functions can be called from a global initializer", name);
+		return {};
+	}
+
 	for (size_t i = 0; i < func.numParams(); i++) {
 		CastTo(context, name, args[i], func.getParam(i));
 	}
@@ -1007,6 +1070,72 @@ RValue Inst::LoadMemberVar(CodeContext& context, RValue baseVar, Token* baseToke
 	return RValue();
 }
 
+RValue Inst::LoadSoaMember(CodeContext& context, RValue arrVar, RValue index, Token* memberName)
+{
+	auto structType = static_cast<SStructType*>(arrVar.stype()->subType());
+	auto member = memberName->str;
+	auto item = structType->getItem(member);
+	if (!item) {
+		context.addError(structType->str(context) + " doesn't have member " + member, memberName);
+		return RValue();
+	} else if (item->size() > 1) {
+		context.addError("member is ambigious: " + member, memberName);
+		return {};
+	}
+
+	vector<Value*> indexes;
+	indexes.push_back(RValue::getZero(context, SType::getInt(context, 32)));
+	indexes.push_back(RValue::getNumVal(context, item->at(0).first));
+	indexes.push_back(index);
+
+	return GetElementPtr(context, arrVar, indexes, item->at(0).second.stype());
+}
+
+RValue Inst::MakeSlice(CodeContext& context, Value* ptr, Value* len, SType* sliceType)
+{
+	auto dataType = static_cast<StructType*>(sliceType->type())->getElementType(0);
+	Value* slice = UndefValue::get(*sliceType);
+	slice = context.IB().CreateInsertValue(slice, context.IB().CreateBitCast(ptr, dataType), 0);
+	slice = context.IB().CreateInsertValue(slice, len, 1);
+	return RValue(slice, sliceType);
+}
+
+RValue Inst::SliceData(CodeContext& context, const RValue& slice)
+{
+	auto arrType = SType::getArray(context, slice.stype()->subType(), 0);
+	auto dataPtr = context.IB().CreateStructGEP(*slice.stype(), slice, 0);
+	auto data = context.IB().CreateLoad(PointerType::getUnqual(*arrType), dataPtr);
+	return RValue(data, arrType);
+}
+
+RValue Inst::SliceLen(CodeContext& context, const RValue& slice)
+{
+	auto int64Ty = SType::getInt(context, 64);
+	auto lenPtr = context.IB().CreateStructGEP(*slice.stype(), slice, 1);
+	return RValue(context.IB().CreateLoad(*int64Ty, lenPtr), int64Ty);
+}
+
+bool Inst::BoundsCheckEnabled(CodeContext& context)
+{
+	return context.config().count("bounds-check") && !NAttributeList::find(context.currFunction().attrs(), "nocheck");
+}
+
+void Inst::BoundsCheck(CodeContext& context, Value* inRange)
+{
+	// keep the check a plain compare and branch to a noreturn block
+	// so IRCE and LICM can remove or hoist it out of loops
+	auto okBlock = context.createBlock();
+	auto trapBlock = context.createBlock();
+	auto weights = MDBuilder(context).createBranchWeights(BOUNDS_OK_WEIGHT, 1);
+	context.IB().CreateCondBr(inRange, okBlock, trapBlock, weights);
+
+	context.pushBlock(trapBlock);
+	context.IB().CreateCall(Intrinsic::getDeclaration(context.getModule(), Intrinsic::trap));
+	context.IB().CreateUnreachable();
+
+	context.pushBlock(okBlock);
+}
+
 void Inst::InitVariable(CodeContext& context, RValue var, const RValue& arrSize, VecRValue* initList, Token* token)
 {
 	auto first = (initList && initList->size() == 1) ? initList->at(0) : RValue();
@@ -1023,22 +1152,142 @@ void Inst::InitVariable(CodeContext& context, RValue var, const RValue& arrSize,
 	auto varType = var.stype();
 	if (initList->empty()) {
 		// no constructor and empty initializer; do zero initialization
-		context.IB().CreateStore(RValue::getZero(context, varType), var);
+		auto byteSize = AggregateByteSize(context, varType, arrSize);
+		if (byteSize) {
+			auto zero = RValue::getZero(context, SType::getInt(context, 8));
+			MemSet(context, var, zero, byteSize, SType::allocAlign(context, varType));
+		} else {
+			context.IB().CreateStore(RValue::getZero(context, varType), var);
+		}
 		return;
 	} else if (initList->size() > 1) {
 		context.addError("invalid variable initializer", token);
 		return;
 	}
 	auto initVal = initList->at(0);
-	if (initVal) {
-		CastTo(context, token, initVal, varType);
+	if (!initVal || CastTo(context, token, initVal, varType))
+		return;
+
+	auto load = dyn_cast<LoadInst>(initVal.value());
+	if (load && load->use_empty() && CopyAggregate(context, var, initVal)) {
+		load->eraseFromParent();
+	} else {
 		context.IB().CreateStore(initVal, var);
 	}
 }
 
+static Value* baseObject(Value* ptr)
+{
+	while (true) {
+		ptr = ptr->stripPointerCasts();
+		auto gep = dyn_cast<GEPOperator>(ptr);
+		if (!gep)
+			return ptr;
+		ptr = gep->getPointerOperand();
+	}
+}
+
+static bool distinctObjects(Value* lhs, Value* rhs)
+{
+	lhs = baseObject(lhs);
+	rhs = baseObject(rhs);
+	auto isObject = [](Value* ptr){ return isa<AllocaInst>(ptr) || isa<GlobalVariable>(ptr); };
+	return lhs != rhs && isObject(lhs) && isObject(rhs);
+}
+
+bool Inst::CopyAggregate(CodeContext& context, Value* dest, const RValue& value)
+{
+	// copy large aggregates directly instead of through a load/store of the whole value
+	auto load = dyn_cast<LoadInst>(value.value());
+	if (!load)
+		return false;
+	auto byteSize = AggregateByteSize(context, value.stype());
+	if (!byteSize)
+		return false;
+	// values behind pointers may partly overlap, which memcpy doesn't allow
+	auto src = load->getPointerOperand();
+	MemCopy(context, dest, src, byteSize, SType::allocAlign(context, value.stype()), !distinctObjects(dest, src));
+	return true;
+}
+
+RValue Inst::AggregateByteSize(CodeContext& context, SType* type, const RValue& arrSize)
+{
+	if ((type->isStruct() || type->isUnion()) && !arrSize) {
+		auto size = SType::allocSize(context, type);
+		return size > MIN_MEM_INTRINSIC_SIZE ? RValue::getNumVal(context, size, 64) : RValue();
+	} else if (!type->isArray()) {
+		return {};
+	}
+
+	if (type->size()) {
+		// a soa array is smaller than its element size times its length
+		auto size = SType::allocSize(context, type);
+		// small arrays are handled fine as a single store
+		return size > MIN_MEM_INTRINSIC_SIZE ? RValue::getNumVal(context, size, 64) : RValue();
+	} else if (!arrSize) {
+		return {};
+	}
+	auto count = arrSize;
+	CastTo(context, nullptr, count, SType::getInt(context, 64, true));
+	return BinaryOp('*', nullptr, count, RValue::getNumVal(context, SType::allocSize(context, type->subType()), 64), context);
+}
+
+void Inst::MemSet(CodeContext& context, Value* ptr, Value* val, Value* size, uint64_t align)
+{
+#if LLVM_VERSION_MAJOR >= 10
+	context.IB().CreateMemSet(ptr, val, size, MaybeAlign(align));
+#else
+	context.IB().CreateMemSet(ptr, val, size, align);
+#endif
+}
+
+void Inst::MemCopy(CodeContext& context, Value* dest, Value* src, Value* size, uint64_t align, bool overlap)
+{
+#if LLVM_VERSION_MAJOR >= 10
+	if (overlap)
+		context.IB().CreateMemMove(dest, MaybeAlign(align), src, MaybeAlign(align), size);
+	else
+		context.IB().CreateMemCpy(dest, MaybeAlign(align), src, MaybeAlign(align), size);
+#else
+	if (overlap)
+		context.IB().CreateMemMove(dest, align, src, align, size);
+	else
+		context.IB().CreateMemCpy(dest, align, src, align, size);
+#endif
+}
+
+static AllocaInst* setAllocaAlign(CodeContext& context, AllocaInst* alloc, SType* type, uint64_t align)
+{
+	// only set the alignment when it's over-aligned to keep the default
+	align = max(align, SType::userAlign(context, type));
+	if (align) {
+		align = max(align, SType::allocAlign(context, type));
+#if LLVM_VERSION_MAJOR >= 11
+		alloc->setAlignment(Align(align));
+#elif LLVM_VERSION_MAJOR >= 10
+		alloc->setAlignment(MaybeAlign(align));
+#else
+		alloc->setAlignment(align);
+#endif
+	}
+	return alloc;
+}
+
+AllocaInst* Inst::Alloca(CodeContext& context, SType* type, const string& name, uint64_t align)
+{
+	return setAllocaAlign(context, context.IB().CreateAlloca(*type, nullptr, name), type, align);
+}
+
+AllocaInst* Inst::EntryAlloca(CodeContext& context, SType* type, const string& name)
+{
+	auto& entry = context.currFunction().funcValue()->getEntryBlock();
+	IRBuilder<> builder(&entry, entry.begin());
+	return setAllocaAlign(context, builder.CreateAlloca(*type, nullptr, name), type, 0);
+}
+
 RValue Inst::StoreTemporary(CodeContext& context, RValue value)
 {
-	auto stackAlloc = context.IB().CreateAlloca(value.type());
+	auto stackAlloc = Alloca(context, value.stype());
 	context.IB().CreateStore(value, stackAlloc);
 	return RValue(stackAlloc, value.stype());
 }
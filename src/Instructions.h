@@ -40,6 +40,8 @@ class Inst
 
 	static RValue CallMemberFunctionNonClass(CodeContext& context, NVariable* baseVar, RValue& baseVal, Token* funcName, NExpressionList* arguments);
 
+	static bool SliceCast(CodeContext& context, Token* token, RValue& value, SType* type);
+
 public:
 	static bool CastTo(CodeContext& context, Token* token, RValue& value, SType* type, bool upcast = false);
 
@@ -49,7 +51,7 @@ public:
 
 	static RValue BinaryOp(int type, Token* optToken, RValue lhs, RValue rhs, CodeContext& context);
 
-	static RValue Branch(BasicBlock* trueBlock, BasicBlock* falseBlock, NExpression* condExp, CodeContext& context);
+	static RValue Branch(BasicBlock* trueBlock, BasicBlock* falseBlock, NExpression* condExp, CodeContext& context, MDNode* weights = nullptr);
 
 	static RValue Cmp(int type, Token* optToken, RValue lhs, RValue rhs, CodeContext& context);
 
@@ -91,8 +93,44 @@ public:
 
 	static RValue LoadMemberVar(CodeContext& context, RValue baseVar, Token* baseToken, Token* memberName);
 
+	static RValue LoadSoaMember(CodeContext& context, RValue arrVar, RValue index, Token* memberName);
+
+	static RValue MakeSlice(CodeContext& context, Value* ptr, Value* len, SType* sliceType);
+
+	static RValue SliceData(CodeContext& context, const RValue& slice);
+
+	static RValue SliceLen(CodeContext& context, const RValue& slice);
+
+	static bool BoundsCheckEnabled(CodeContext& context);
+
+	static void BoundsCheck(CodeContext& context, Value* inRange);
+
 	static void InitVariable(CodeContext& context, RValue var, const RValue& arrSize, VecRValue* initList, Token* token);
 
+	/**
+	 * @return the size in bytes of an array, struct or union large enough
+	 * to use memory intrinsics instead of a load/store of the whole value
+	 */
+	static RValue AggregateByteSize(CodeContext& context, SType* type, const RValue& arrSize = {});
+
+	/**
+	 * copies a large aggregate that was loaded from memory directly to dest
+	 * @return false if the value must be copied with a normal store
+	 */
+	static bool CopyAggregate(CodeContext& context, Value* dest, const RValue& value);
+
+	static void MemSet(CodeContext& context, Value* ptr, Value* val, Value* size, uint64_t align);
+
+	static void MemCopy(CodeContext& context, Value* dest, Value* src, Value* size, uint64_t align, bool overlap = false);
+
+	static AllocaInst* Alloca(CodeContext& context, SType* type, const string& name = "", uint64_t align = 0);
+
+	/**
+	 * creates the alloca at the start of the function's entry block so a
+	 * temporary created inside a loop doesn't grow the stack each iteration
+	 */
+	static AllocaInst* EntryAlloca(CodeContext& context, SType* type, const string& name = "");
+
 	static RValue StoreTemporary(CodeContext& context, RValue value);
 
 	static RValue StoreTemporary(CodeContext& context, NExpression* exp);
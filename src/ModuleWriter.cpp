@@ -33,6 +33,20 @@
 #include <llvm/Support/FileSystem.h>
 #include <llvm/Support/raw_os_ostream.h>
 #include <llvm/Target/TargetOptions.h>
+#include <llvm/Transforms/IPO/AlwaysInliner.h>
+#include <llvm/Transforms/InstCombine/InstCombine.h>
+#include <llvm/Transforms/Scalar.h>
+#include <llvm/Transforms/Utils.h>
+#if LLVM_VERSION_MAJOR >= 15
+	#include <llvm/Passes/PassBuilder.h>
+	#include <llvm/Transforms/Coroutines/CoroCleanup.h>
+	#include <llvm/Transforms/Coroutines/CoroEarly.h>
+	#include <llvm/Transforms/Coroutines/CoroElide.h>
+	#include <llvm/Transforms/Coroutines/CoroSplit.h>
+	#include <llvm/Transforms/Utils/Mem2Reg.h>
+#else
+	#include <llvm/Transforms/Coroutines.h>
+#endif
 
 #include "Pass.h"
 
@@ -70,13 +84,84 @@ TargetMachine* ModuleWriter::getMachine()
 	return target->createTargetMachine(triple.getTriple(), sys::getHostCPUName(), features, options, Reloc::Model::Static, CodeModel::Medium, CodeGenOpt::Default);
 }
 
+bool ModuleWriter::hasCoroutines()
+{
+	return module.getFunction("llvm.coro.id");
+}
+
+#if LLVM_VERSION_MAJOR >= 15
+void ModuleWriter::lowerCoroutines()
+{
+	LoopAnalysisManager lam;
+	FunctionAnalysisManager fam;
+	CGSCCAnalysisManager cgam;
+	ModuleAnalysisManager mam;
+	PassBuilder pb;
+	pb.registerModuleAnalyses(mam);
+	pb.registerCGSCCAnalyses(cgam);
+	pb.registerFunctionAnalyses(fam);
+	pb.registerLoopAnalyses(lam);
+	pb.crossRegisterProxies(lam, fam, cgam, mam);
+
+	ModulePassManager mpm;
+#if LLVM_VERSION_MAJOR >= 16
+	mpm.addPass(CoroEarlyPass());
+#else
+	mpm.addPass(createModuleToFunctionPassAdaptor(CoroEarlyPass()));
+#endif
+	// the caller must hold the handle in a register and address the frame through
+	// coro.begin after inlining the ramp, otherwise CoroElide keeps the allocation
+	mpm.addPass(createModuleToFunctionPassAdaptor(PromotePass()));
+	mpm.addPass(createModuleToPostOrderCGSCCPassAdaptor(CoroSplitPass()));
+	mpm.addPass(AlwaysInlinerPass());
+	mpm.addPass(createModuleToFunctionPassAdaptor(InstCombinePass()));
+	mpm.addPass(createModuleToFunctionPassAdaptor(CoroElidePass()));
+#if LLVM_VERSION_MAJOR >= 16
+	mpm.addPass(CoroCleanupPass());
+#else
+	mpm.addPass(createModuleToFunctionPassAdaptor(CoroCleanupPass()));
+#endif
+	mpm.run(module, mam);
+}
+#endif
+
 int ModuleWriter::run()
 {
 	auto noClean = config.count("noclean");
 	if (!noClean) {
+		vector<pair<string, int>> heapStats;
 		llvm::legacy::PassManager clean;
 		clean.add(new SimpleBlockClean());
+		if (config.count("heap-to-stack"))
+			clean.add(new HeapToStack(config.count("heap-stat")? &heapStats : nullptr));
+		clean.add(new TailCallMark());
+		if (config.count("tail-calls"))
+			clean.add(createTailCallEliminationPass());
+#if LLVM_VERSION_MAJOR < 15
+		if (hasCoroutines()) {
+			clean.add(createCoroEarlyLegacyPass());
+			// lets CoroElide find the frames of the inlined ramps
+			clean.add(createPromoteMemoryToRegisterPass());
+			clean.add(createCoroSplitLegacyPass());
+			clean.add(createAlwaysInlinerLegacyPass());
+			clean.add(createInstructionCombiningPass());
+			clean.add(createCoroElideLegacyPass());
+		}
+#endif
 		clean.run(module);
+#if LLVM_VERSION_MAJOR >= 15
+		if (hasCoroutines())
+			lowerCoroutines();
+#else
+		if (hasCoroutines()) {
+			// run separately so the ramps keep their intrinsics until they're inlined
+			llvm::legacy::PassManager coroClean;
+			coroClean.add(createCoroCleanupLegacyPass());
+			coroClean.run(module);
+		}
+#endif
+		for (auto& item : heapStats)
+			cout << item.first << ": moved " << item.second << " heap allocations to the stack" << endl;
 	}
 
 	auto noVerify = noClean || config.count("noverify");
@@ -36,6 +36,12 @@ class ModuleWriter
 
 	bool validModule();
 
+	bool hasCoroutines();
+
+#if LLVM_VERSION_MAJOR >= 15
+	void lowerCoroutines();
+#endif
+
 	static void initTarget();
 
 	TargetMachine* getMachine();
@@ -49,12 +49,16 @@
 %token <t_tok> TT_ASG_RSH TT_ASG_AND TT_ASG_OR TT_ASG_XOR TT_INC TT_DEC TT_DQ_MARK
 %token <t_tok> TT_ASG_DQ
 // other tokens
-%token <t_tok> TT_ATTR_OPEN TT_ARROW TT_DB_ARROW
+%token <t_tok> TT_ATTR_OPEN TT_ARROW TT_DB_ARROW TT_DOT_DOT
 // keywords
 %token TT_RETURN TT_WHILE TT_DO TT_UNTIL TT_CONTINUE TT_REDO TT_BREAK TT_FOR TT_IF
 %token TT_GOTO TT_SWITCH TT_CASE TT_DEFAULT TT_STRUCT TT_UNION TT_ENUM
 %token TT_DELETE TT_NEW TT_LOOP TT_ALIAS TT_VEC TT_CLASS TT_IMPORT TT_PACKAGE
+%token TT_YIELD TT_AWAIT
 %left TT_ELSE
+// "delete (ptr)[..];" indexes ptr instead of using it as an allocator
+%nonassoc '[' '@' '$'
+%nonassoc TT_PAREN_EXP
 // constants and names
 %token <t_tok> TT_INTEGER TT_FLOATING TT_IDENTIFIER TT_INT_BIN TT_INT_OCT TT_INT_HEX TT_CHAR_LIT TT_STR_LIT TT_THIS
 
@@ -63,11 +67,11 @@
 // integer constant
 %type <t_const_int> integer_constant
 // data types
-%type <t_dtype> data_type base_type explicit_data_type variable_type
+%type <t_dtype> data_type base_type explicit_data_type variable_type template_argument_item
 // parameter
 %type <t_param> parameter
 // variable
-%type <t_var> variable_expression base_variable_expression function_call arrow_expression
+%type <t_var> variable_expression base_variable_expression function_call arrow_expression lambda_capture
 // variable declaration
 %type <t_var_decl> variable global_variable
 // operators
@@ -76,7 +80,7 @@
 // keywords
 %type <t_tok_int> branch_keyword
 // statements
-%type <t_stm> statement declaration function_declaration while_loop branch_statement
+%type <t_stm> statement declaration function_declaration loop_statement branch_statement
 %type <t_stm> variable_declarations condition_statement global_variable_declaration
 %type <t_stm> struct_declaration enum_declaration alias_declaration
 %type <t_stm> class_declaration import_declaration package_declaration
@@ -99,10 +103,10 @@
 %type <t_stmlist> declaration_or_expression_list else_statement function_body
 %type <t_clslist> class_member_list class_body
 %type <t_varlist> variable_list global_variable_list
-%type <t_explist> expression_list
+%type <t_explist> expression_list lambda_capture_list
 %type <t_parlist> parameter_list
 %type <t_caslist> switch_case_list
-%type <t_typelist> data_type_list arrow_argument template_argument
+%type <t_typelist> data_type_list arrow_argument template_argument template_argument_list
 %type <t_var_dec_list> variable_declarations_list variable_declarations_list_or_empty struct_body
 %type <t_initlist> class_initializer_list
 %type <t_attrlist> attribute_list attribute_declaration optional_attribute_declaration
@@ -193,6 +197,10 @@ global_variable_declaration
 	{
 		$$ = new NVariableDeclGroup($1, $2);
 	}
+	| attribute_declaration data_type global_variable_list ';'
+	{
+		$$ = new NVariableDeclGroup($2, $3, $1);
+	}
 	;
 alias_declaration
 	: TT_ALIAS TT_IDENTIFIER '=' data_type ';'
@@ -287,11 +295,46 @@ template_argument
 	{
 		$$ = nullptr;
 	}
-	| '<' data_type_list '>'
+	| '<' template_argument_list '>'
 	{
 		$$ = $2;
 	}
 	;
+template_argument_list
+	:
+	{
+		$$ = new NDataTypeList;
+	}
+	| template_argument_item
+	{
+		$$ = new NDataTypeList;
+		$$->add($1);
+	}
+	| template_argument_list ',' template_argument_item
+	{
+		$1->add($3);
+		$$ = $1;
+	}
+	;
+template_argument_item
+	: data_type
+	| integer_constant
+	{
+		$$ = new NConstValueType($1);
+	}
+	| '-' integer_constant
+	{
+		$$ = new NConstValueType(new NUnaryMathOperator('-', $1.t_tok, $2));
+	}
+	| TT_TRUE
+	{
+		$$ = new NConstValueType(new NBoolConst($1, true));
+	}
+	| TT_FALSE
+	{
+		$$ = new NConstValueType(new NBoolConst($1, false));
+	}
+	;
 identifier_list
 	:
 	{
@@ -338,6 +381,10 @@ attribute
 	{
 		$$ = new NAttribute($1);
 	}
+	| TT_CONST
+	{
+		$$ = new NAttribute($1);
+	}
 	| TT_IDENTIFIER '(' attribute_value_list ')'
 	{
 		$$ = new NAttribute($1, $3);
@@ -400,6 +447,14 @@ function_declaration
 	{
 		$$ = new NFunctionDeclaration($3, $2, $5, $7, $1);
 	}
+	| data_type TT_IDENTIFIER '<' identifier_list '>' '(' parameter_list ')' function_body
+	{
+		$$ = new NFunctionDeclaration($2, $1, $7, $9, nullptr, $4);
+	}
+	| attribute_declaration data_type TT_IDENTIFIER '<' identifier_list '>' '(' parameter_list ')' function_body
+	{
+		$$ = new NFunctionDeclaration($3, $2, $8, $10, $1, $5);
+	}
 	;
 function_body
 	: compound_statement
@@ -447,7 +502,11 @@ statement_list
 	;
 statement
 	: variable_declarations ';'
-	| while_loop
+	| attribute_declaration variable_type variable_list ';'
+	{
+		$$ = new NVariableDeclGroup($2, $3, $1);
+	}
+	| loop_statement
 	| branch_statement
 	| condition_statement
 	| expression ';'
@@ -470,6 +529,18 @@ statement
 	{
 		$$ = new NReturnStatement($1.t_tok, $2);
 	}
+	| attribute_declaration TT_RETURN expression_or_empty ';'
+	{
+		$$ = new NReturnStatement($2.t_tok, $3, $1);
+	}
+	| TT_YIELD expression_or_empty ';'
+	{
+		$$ = new NYieldStatement($1.t_tok, $2);
+	}
+	| TT_AWAIT expression ';'
+	{
+		$$ = new NAwaitStatement($1.t_tok, $2);
+	}
 	| TT_DELETE variable_expression ';'
 	{
 		$$ = new NDeleteStatement($2);
@@ -478,13 +549,13 @@ statement
 	{
 		$$ = new NDeleteStatement($5, $3);
 	}
-	| TT_FOR '(' declaration_or_expression_list ';' expression_or_empty ';' expression_list ')' single_statement
+	| TT_DELETE '(' expression ')' variable_expression ';'
 	{
-		$$ = new NForStatement($3, $5, $7, $9);
+		$$ = new NDeleteStatement($5, nullptr, $3);
 	}
-	| TT_LOOP single_statement
+	| TT_DELETE '[' expression ']' '(' expression ')' variable_expression ';'
 	{
-		$$ = new NLoopStatement($2);
+		$$ = new NDeleteStatement($8, $3, $6);
 	}
 	| '~' TT_THIS '(' ')' ';'
 	{
@@ -495,22 +566,34 @@ statement
 		$$ = new NDestructorCall($1, $4);
 	}
 	;
-while_loop
-	: TT_WHILE '(' expression_or_empty ')' single_statement
+loop_statement
+	: optional_attribute_declaration TT_WHILE '(' expression_or_empty ')' single_statement
+	{
+		$$ = new NWhileStatement($4, $6, false, false, $1);
+	}
+	| optional_attribute_declaration TT_DO single_statement TT_WHILE '(' expression_or_empty ')' ';'
+	{
+		$$ = new NWhileStatement($6, $3, true, false, $1);
+	}
+	| optional_attribute_declaration TT_UNTIL '(' expression_or_empty ')' single_statement
+	{
+		$$ = new NWhileStatement($4, $6, false, true, $1);
+	}
+	| optional_attribute_declaration TT_DO single_statement TT_UNTIL '(' expression_or_empty ')' ';'
 	{
-		$$ = new NWhileStatement($3, $5);
+		$$ = new NWhileStatement($6, $3, true, true, $1);
 	}
-	| TT_DO single_statement TT_WHILE '(' expression_or_empty ')' ';'
+	| optional_attribute_declaration TT_FOR '(' declaration_or_expression_list ';' expression_or_empty ';' expression_list ')' single_statement
 	{
-		$$ = new NWhileStatement($5, $2, true);
+		$$ = new NForStatement($4, $6, $8, $10, $1);
 	}
-	| TT_UNTIL '(' expression_or_empty ')' single_statement
+	| optional_attribute_declaration TT_FOR '(' variable_type TT_IDENTIFIER ':' expression ')' single_statement
 	{
-		$$ = new NWhileStatement($3, $5, false, true);
+		$$ = new NForEachStatement($4, $5, $7, $9, $1);
 	}
-	| TT_DO single_statement TT_UNTIL '(' expression_or_empty ')' ';'
+	| optional_attribute_declaration TT_LOOP single_statement
 	{
-		$$ = new NWhileStatement($5, $2, true, true);
+		$$ = new NLoopStatement($3, $1);
 	}
 	;
 switch_case_list
@@ -526,13 +609,17 @@ switch_case_list
 	}
 	;
 switch_case
-	: TT_CASE expression ':' statement_list_or_empty
+	: TT_CASE optional_attribute_declaration expression ':' statement_list_or_empty
+	{
+		$$ = new NSwitchCase($1.t_tok, $5, $3, $2);
+	}
+	| TT_CASE optional_attribute_declaration expression TT_DOT_DOT expression ':' statement_list_or_empty
 	{
-		$$ = new NSwitchCase($1.t_tok, $4, $2);
+		$$ = new NSwitchCase($1.t_tok, $7, $3, $2, $5);
 	}
-	| TT_DEFAULT ':' statement_list_or_empty
+	| TT_DEFAULT optional_attribute_declaration ':' statement_list_or_empty
 	{
-		$$ = new NSwitchCase($1.t_tok, $3);
+		$$ = new NSwitchCase($1.t_tok, $4, nullptr, $2);
 	}
 	;
 branch_statement
@@ -551,9 +638,9 @@ branch_keyword
 	| TT_REDO     { $$ = {$1.t_tok, TT_REDO}; }
 	;
 condition_statement
-	: TT_IF '(' expression ')' single_statement else_statement
+	: optional_attribute_declaration TT_IF '(' expression ')' single_statement else_statement
 	{
-		$$ = new NIfStatement($3, $5, $6);
+		$$ = new NIfStatement($4, $6, $7, $1);
 	}
 	;
 else_statement
@@ -697,6 +784,10 @@ explicit_data_type
 	{
 		$$ = new NArrayType($1.t_tok, $3);
 	}
+	| '[' ':' ']' data_type
+	{
+		$$ = new NSliceType($1.t_tok, $4);
+	}
 	| TT_VEC '<' expression ',' data_type '>'
 	{
 		$$ = new NVecType($1.t_tok, $3, $5);
@@ -826,10 +917,44 @@ new_expression
 	{
 		$$ = new NNewExpression($1.t_tok, $2, $4);
 	}
+	| TT_NEW '(' expression ')' data_type
+	{
+		$$ = new NNewExpression($1.t_tok, $5, nullptr, $3);
+	}
+	| TT_NEW '(' expression ')' data_type '{' expression_list '}'
+	{
+		$$ = new NNewExpression($1.t_tok, $5, $7, $3);
+	}
 	| '|' parameter_list '|' TT_DB_ARROW data_type '{' statement_list_or_empty '}'
 	{
 		$$ = new NLambdaFunction($1.t_tok, $2, $5, $7);
 	}
+	| '|' parameter_list '|' '[' lambda_capture_list ']' TT_DB_ARROW data_type '{' statement_list_or_empty '}'
+	{
+		$$ = new NLambdaFunction($1.t_tok, $2, $8, $10, $5);
+	}
+	;
+lambda_capture_list
+	: lambda_capture
+	{
+		$$ = new NExpressionList;
+		$$->add($1);
+	}
+	| lambda_capture_list ',' lambda_capture
+	{
+		$1->add($3);
+		$$ = $1;
+	}
+	;
+lambda_capture
+	: TT_IDENTIFIER
+	{
+		$$ = new NBaseVariable($1);
+	}
+	| '$' TT_IDENTIFIER
+	{
+		$$ = new NAddressOf(new NBaseVariable($2), $1.t_tok);
+	}
 	;
 logical_or_expression
 	: logical_and_expression
@@ -981,6 +1106,10 @@ function_call
 	{
 		$$ = new NFunctionCall($1, $3);
 	}
+	| TT_IDENTIFIER '!' '<' template_argument_list '>' '(' expression_list ')'
+	{
+		$$ = new NFunctionCall($1, $7, $4);
+	}
 	;
 increment_decrement_expression
 	: increment_decrement_operator variable_expression
@@ -1005,7 +1134,7 @@ base_variable_expression
 	{
 		$$ = new NBaseVariable($1);
 	}
-	| '(' expression ')'
+	| '(' expression ')' %prec TT_PAREN_EXP
 	{
 		$$ = new NExprVariable($2);
 	}
@@ -1021,6 +1150,10 @@ variable_expression
 	{
 		$$ = new NArrayVariable($1, $2.t_tok, $3);
 	}
+	| variable_expression '[' expression_or_empty ':' expression_or_empty ']'
+	{
+		$$ = new NSliceVariable($1, $2.t_tok, $3, $5);
+	}
 	| variable_expression '.' TT_IDENTIFIER
 	{
 		$$ = new NMemberVariable($1, $3);
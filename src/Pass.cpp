@@ -15,10 +15,16 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <set>
 #include <llvm/IR/Instructions.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/IntrinsicInst.h>
 #include <llvm/IR/CFG.h>
 #include "Pass.h"
 
+// largest malloc that will be moved to the stack
+#define HEAP_TO_STACK_MAX 1024
+
 using namespace std;
 
 char SimpleBlockClean::ID = 0;
@@ -71,3 +77,173 @@ bool SimpleBlockClean::runOnFunction(Function &func)
 	}
 	return modified;
 }
+
+char HeapToStack::ID = 0;
+
+bool HeapToStack::isFree(StringRef name)
+{
+	return name == "free" || name == "free_sized" || name == "free_aligned_sized";
+}
+
+bool HeapToStack::inLoop(BasicBlock* block)
+{
+	set<BasicBlock*> visited;
+	vector<BasicBlock*> work(succ_begin(block), succ_end(block));
+	while (!work.empty()) {
+		auto curr = work.back();
+		work.pop_back();
+		if (curr == block)
+			return true;
+		else if (!visited.insert(curr).second)
+			continue;
+		work.insert(work.end(), succ_begin(curr), succ_end(curr));
+	}
+	return false;
+}
+
+bool HeapToStack::isLocal(CallInst* alloc, vector<CallInst*>& frees)
+{
+	vector<Value*> work{alloc};
+	while (!work.empty()) {
+		auto ptr = work.back();
+		work.pop_back();
+
+		for (auto user : ptr->users()) {
+			if (isa<BitCastInst>(user) || isa<GetElementPtrInst>(user)) {
+				work.push_back(user);
+			} else if (isa<LoadInst>(user) || isa<ICmpInst>(user)) {
+				continue;
+			} else if (auto store = dyn_cast<StoreInst>(user)) {
+				if (store->getValueOperand() != ptr)
+					continue;
+
+				// storing into a local variable is fine as long as
+				// that variable is only ever loaded from afterwards
+				auto var = dyn_cast<AllocaInst>(store->getPointerOperand());
+				if (!var)
+					return false;
+				for (auto varUser : var->users()) {
+					if (isa<LoadInst>(varUser))
+						work.push_back(varUser);
+					else if (varUser != store)
+						return false;
+				}
+			} else if (auto call = dyn_cast<CallInst>(user)) {
+				// the pointer must be the freed value, not the size or alignment
+				auto func = call->getCalledFunction();
+				if (!func || call->getArgOperand(0) != ptr || !isFree(func->getName()))
+					return false;
+				frees.push_back(call);
+			} else {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+bool HeapToStack::runOnFunction(Function &func)
+{
+	// malloc(size) or aligned_alloc(align, size), with the alignment to keep
+	vector<pair<CallInst*, uint64_t>> mallocs;
+	for (auto& block : func) {
+		for (auto& inst : block) {
+			auto call = dyn_cast<CallInst>(&inst);
+			if (!call || !call->getCalledFunction())
+				continue;
+			auto name = call->getCalledFunction()->getName();
+			ConstantInt* size;
+			uint64_t align = 16;
+			if (name == "malloc") {
+				size = dyn_cast<ConstantInt>(call->getArgOperand(0));
+			} else if (name == "aligned_alloc") {
+				auto alignVal = dyn_cast<ConstantInt>(call->getArgOperand(0));
+				if (!alignVal)
+					continue;
+				align = alignVal->getZExtValue();
+				size = dyn_cast<ConstantInt>(call->getArgOperand(1));
+			} else {
+				continue;
+			}
+			if (size && size->getZExtValue() <= HEAP_TO_STACK_MAX && !inLoop(&block))
+				mallocs.push_back({call, align});
+		}
+	}
+
+	int moved = 0;
+	for (auto item : mallocs) {
+		auto call = item.first;
+		vector<CallInst*> frees;
+		if (!isLocal(call, frees))
+			continue;
+
+		auto& entry = func.getEntryBlock();
+		IRBuilder<> builder(&entry, entry.begin());
+		auto alloc = builder.CreateAlloca(builder.getInt8Ty(), call->getArgOperand(call->arg_size() - 1));
+		// keep the alignment guarantee of the allocation function
+#if LLVM_VERSION_MAJOR >= 11
+		alloc->setAlignment(Align(item.second));
+#elif LLVM_VERSION_MAJOR >= 10
+		alloc->setAlignment(MaybeAlign(item.second));
+#else
+		alloc->setAlignment(item.second);
+#endif
+
+		for (auto free : frees)
+			free->eraseFromParent();
+		call->replaceAllUsesWith(alloc);
+		call->eraseFromParent();
+		moved++;
+	}
+
+	if (stats && moved)
+		stats->push_back({func.getName().str(), moved});
+	return moved;
+}
+
+char TailCallMark::ID = 0;
+
+bool TailCallMark::escapes(Value* ptr)
+{
+	for (auto user : ptr->users()) {
+		if (isa<LoadInst>(user) || isa<DbgInfoIntrinsic>(user) || isa<MemIntrinsic>(user)) {
+			continue;
+		} else if (auto store = dyn_cast<StoreInst>(user)) {
+			if (store->getValueOperand() == ptr)
+				return true;
+		} else if (isa<BitCastInst>(user) || isa<GetElementPtrInst>(user)) {
+			if (escapes(user))
+				return true;
+		} else {
+			return true;
+		}
+	}
+	return false;
+}
+
+bool TailCallMark::runOnFunction(Function &func)
+{
+	// a tail call can't reference the caller's stack, locals declared
+	// after the first block are allocated where they're declared
+	for (auto& block : func) {
+		for (auto& inst : block) {
+			if (isa<AllocaInst>(inst) && escapes(&inst))
+				return false;
+		}
+	}
+
+	bool modified = false;
+	for (auto& block : func) {
+		auto ret = dyn_cast<ReturnInst>(block.getTerminator());
+		auto call = ret? dyn_cast_or_null<CallInst>(ret->getPrevNode()) : nullptr;
+		if (!call || call->isTailCall() || isa<IntrinsicInst>(call))
+			continue;
+
+		auto retVal = ret->getReturnValue();
+		if (retVal? retVal == call : call->use_empty()) {
+			call->setTailCall();
+			modified = true;
+		}
+	}
+	return modified;
+}
@@ -17,7 +17,9 @@
 #ifndef __PASS_H__
 #define __PASS_H__
 
+#include <vector>
 #include <llvm/Pass.h>
+#include <llvm/IR/Instructions.h>
 
 using namespace llvm;
 
@@ -39,4 +41,53 @@ public:
 	bool runOnFunction(Function &func);
 };
 
+class HeapToStack : public FunctionPass
+{
+	std::vector<std::pair<std::string, int>>* stats;
+
+	static bool isFree(StringRef name);
+
+	bool inLoop(BasicBlock* block);
+
+	bool isLocal(CallInst* alloc, std::vector<CallInst*>& frees);
+
+public:
+	static char ID;
+
+	/**
+	 * @param stats when set, receives the number of allocations moved for each function
+	 */
+	explicit HeapToStack(std::vector<std::pair<std::string, int>>* stats = nullptr)
+	: FunctionPass(ID), stats(stats) {}
+
+	StringRef getPassName() const
+	{
+		return "HeapToStack";
+	}
+
+	bool runOnFunction(Function &func);
+};
+
+/**
+ * marks calls directly before a return of their value as tail calls,
+ * unless an alloca of the function escapes
+ */
+class TailCallMark : public FunctionPass
+{
+	bool escapes(Value* ptr);
+
+public:
+	static char ID;
+
+	TailCallMark()
+	: FunctionPass(ID) {}
+
+	StringRef getPassName() const
+	{
+		return "TailCallMark";
+	}
+
+	bool runOnFunction(Function &func);
+};
+
 #endif
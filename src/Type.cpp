@@ -131,6 +131,16 @@ SType* SType::getVec(CodeContext& context, SType* vecType, uint64_t size)
 	return context.getTypeManager().getVec(vecType, size);
 }
 
+SType* SType::getSlice(CodeContext& context, SType* elType)
+{
+	return context.getTypeManager().getSlice(elType);
+}
+
+SType* SType::getConstValue(CodeContext& context, SType* valueType, int64_t value)
+{
+	return context.getTypeManager().getConstValue(valueType, value);
+}
+
 SType* SType::getPointer(CodeContext& context, SType* ptrType)
 {
 	return context.getTypeManager().getPointer(ptrType);
@@ -146,6 +156,11 @@ SType * SType::getCopyRef(CodeContext& context, SType* type)
 	return context.getTypeManager().getCopyRef(type);
 }
 
+SType* SType::getAsync(CodeContext& context, SType* promiseType)
+{
+	return context.getTypeManager().getAsync(promiseType);
+}
+
 SFunctionType* SType::getFunction(CodeContext& context, SType* returnTy, VecSType params)
 {
 	return context.getTypeManager().getFunction(returnTy, params);
@@ -156,6 +171,16 @@ uint64_t SType::allocSize(CodeContext& context, SType* type)
 	return context.getTypeManager().allocSize(type);
 }
 
+uint64_t SType::allocAlign(CodeContext& context, SType* type)
+{
+	return context.getTypeManager().allocAlign(type);
+}
+
+uint64_t SType::userAlign(CodeContext& context, SType* type)
+{
+	return context.getTypeManager().userAlign(type);
+}
+
 SType* SType::numericConv(CodeContext& context, Token* optToken, SType* ltype, SType* rtype, bool int32min)
 {
 	switch (ltype->isVec() | (rtype->isVec() << 1)) {
@@ -384,9 +409,9 @@ SUnionType* SUserType::createUnion(CodeContext& context, const string& name, con
 	return context.getTypeManager().createUnion(name, rawName, templateArgs);
 }
 
-void SUserType::setBody(CodeContext& context, STemplatedType* type, const vector<pair<string, SType*>>& structure)
+void SUserType::setBody(CodeContext& context, STemplatedType* type, const vector<pair<string, SType*>>& structure, bool packed, uint64_t align, bool soa)
 {
-	context.getTypeManager().setBody(type, structure);
+	context.getTypeManager().setBody(type, structure, packed, align, soa);
 }
 
 void SUserType::createEnum(CodeContext& context, const string& name, const vector<pair<string, int64_t>>& structure, SType* type)
@@ -428,14 +453,23 @@ TypeManager::TypeManager(Module* module)
 SType* TypeManager::getArray(SType* arrType, int64_t size)
 {
 	STypePtr &item = arrMap[make_pair(arrType, size)];
-	if (!item.get())
+	if (item.get()) {
+		return item.get();
+	} else if (size && arrType->isStruct() && static_cast<SStructType*>(arrType)->soa) {
+		// store each member in its own array
+		vector<Type*> members;
+		for (auto member : static_cast<StructType*>(arrType->ltype)->elements())
+			members.push_back(ArrayType::get(member, size));
+		item = uPtrSType(SType::ARRAY | SType::SOA, StructType::get(context, members), size, arrType);
+	} else {
 		item = uPtrSType(SType::ARRAY, ArrayType::get(*arrType, size), size, arrType);
+	}
 	return item.get();
 }
 
 SType* TypeManager::getVec(SType* vecType, int64_t size)
 {
-	STypePtr &item = arrMap[make_pair(vecType, size)];
+	STypePtr &item = vecMap[make_pair(vecType, size)];
 	if (!item.get())
 #if LLVM_VERSION_MAJOR >= 11
 		item = uPtrSType(SType::VEC, FixedVectorType::get(*vecType, size), size, vecType);
@@ -445,6 +479,25 @@ SType* TypeManager::getVec(SType* vecType, int64_t size)
 	return item.get();
 }
 
+SType* TypeManager::getSlice(SType* elType)
+{
+	STypePtr &item = sliceMap[elType];
+	if (!item.get()) {
+		auto ptr = PointerType::getUnqual(ArrayType::get(*elType, 0));
+		auto ltype = StructType::get(context, {ptr, int64Ty->ltype});
+		item = uPtrSType(SType::SLICE, ltype, 0, elType);
+	}
+	return item.get();
+}
+
+SType* TypeManager::getConstValue(SType* valueType, int64_t value)
+{
+	STypePtr &item = constValMap[make_pair(valueType, value)];
+	if (!item.get())
+		item = uPtrSType(SType::CONST_VALUE, *valueType, value, valueType);
+	return item.get();
+}
+
 SType* TypeManager::getPointer(SType* ptrType)
 {
 	STypePtr &item = ptrMap[ptrType];
@@ -476,6 +529,16 @@ SType* TypeManager::getCopyRef(SType* type)
 	return item.get();
 }
 
+SType* TypeManager::getAsync(SType* promiseType)
+{
+	STypePtr &item = asyncMap[promiseType];
+	if (!item.get()) {
+		auto llptr = PointerType::getUnqual(*promiseType);
+		item = uPtrSType(SType::POINTER | SType::ASYNC | SType::UNSIGNED, llptr, 0, promiseType);
+	}
+	return item.get();
+}
+
 SFunctionType* TypeManager::getFunction(SType* returnTy, VecSType args)
 {
 	SFuncPtr &item = funcMap[make_pair(returnTy, args)];
@@ -494,20 +557,42 @@ void TypeManager::createAlias(const string& name, SType* type)
 	item = uPtrSAlias(name, type);
 }
 
-void TypeManager::setBody(STemplatedType* type, const vector<pair<string,SType*>>& structure)
+void TypeManager::setBody(STemplatedType* type, const vector<pair<string,SType*>>& structure, bool packed, uint64_t align, bool soa)
 {
 	if (structure.size())
 		type->tclass &= ~SType::OPAQUE;
 	else
 		return;
 
+	// the layout is tracked to add padding for members, or the type
+	// itself, that require more than their natural alignment
 	vector<Type*> elements;
+	uint64_t offset = 0;
+	uint64_t naturalAlign = 1;
+	auto addPadding = [&](uint64_t size) {
+		if (size) {
+			elements.push_back(ArrayType::get(*int8Ty, size));
+			offset += size;
+		}
+	};
+
 	if (type->isStruct()) {
 		auto sTy = static_cast<SStructType*>(type);
-		int i = 0;
+		sTy->soa = soa;
 		for (auto item : structure) {
-			sTy->items[item.first].push_back(make_pair(i++, RValue(nullptr, item.second)));
+			uint64_t itemAlign = 1;
+			if (!packed) {
+				auto itemNatural = datalayout.getABITypeAlignment(*item.second);
+				itemAlign = allocAlign(item.second);
+				naturalAlign = max<uint64_t>(naturalAlign, itemNatural);
+				addPadding(alignTo(offset, itemAlign) - alignTo(offset, itemNatural));
+				offset = alignTo(offset, itemNatural);
+			}
+			align = max(align, itemAlign);
+
+			sTy->items[item.first].push_back(make_pair(elements.size(), RValue(nullptr, item.second)));
 			elements.push_back(*item.second);
+			offset += allocSize(item.second);
 		}
 	} else if (type->isUnion()) {
 		auto uTy = static_cast<SUnionType*>(type);
@@ -519,12 +604,21 @@ void TypeManager::setBody(STemplatedType* type, const vector<pair<string,SType*>
 				size = tsize;
 				rawType = item.second;
 			}
+			if (!packed)
+				align = max(align, userAlign(item.second));
 			uTy->items[item.first] = item.second;
 		}
 		elements.push_back(*rawType);
+		offset = size;
+		if (!packed)
+			naturalAlign = datalayout.getABITypeAlignment(*rawType);
 	}
 
-	static_cast<StructType*>(type->ltype)->setBody(elements);
+	if (align > naturalAlign) {
+		addPadding(alignTo(offset, align) - alignTo(offset, naturalAlign));
+		type->align = align;
+	}
+	static_cast<StructType*>(type->ltype)->setBody(elements, packed);
 }
 
 SStructType* TypeManager::createStruct(const string& name, const string& rawName, const VecSType& templateArgs)
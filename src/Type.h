@@ -86,7 +86,11 @@ public:
 		CONST    = 1 << 16,
 		TEMPLATED = 1 << 17,
 		REFERENCE = 1 << 18,
-		COPY_REF  = 1 << 19
+		COPY_REF  = 1 << 19,
+		SOA       = 1 << 20,
+		SLICE     = 1 << 21,
+		CONST_VALUE = 1 << 22,
+		ASYNC     = 1 << 23
 	};
 
 	static vector<Type*> convertArr(VecSType arr)
@@ -125,6 +129,14 @@ public:
 
 	static uint64_t allocSize(CodeContext& context, SType* type);
 
+	static uint64_t allocAlign(CodeContext& context, SType* type);
+
+	/**
+	 * @return the alignment requested by an align attribute on the type
+	 * (or the element type of an array), or 0 if there isn't one
+	 */
+	static uint64_t userAlign(CodeContext& context, SType* type);
+
 	static SType* numericConv(CodeContext& context, Token* optToken, SType* ltype, SType* rtype, bool int32min = true);
 
 	static SType* getSuffixType(CodeContext& context, const string& name);
@@ -147,14 +159,24 @@ public:
 
 	static SType* getVec(CodeContext& context, SType* vecType, uint64_t size);
 
+	static SType* getSlice(CodeContext& context, SType* elType);
+
 	static SType* getPointer(CodeContext& context, SType* ptrType);
 
 	static SType* getReference(CodeContext& context, SType* type);
 
 	static SType* getCopyRef(CodeContext& context, SType* type);
 
+	/**
+	 * the result of an async function, a pointer to its promise
+	 * that only the coroutine builtins accept
+	 */
+	static SType* getAsync(CodeContext& context, SType* promiseType);
+
 	static SFunctionType* getFunction(CodeContext& context, SType* returnTy, VecSType params);
 
+	static SType* getConstValue(CodeContext& context, SType* valueType, int64_t value);
+
 	operator Type*() const
 	{
 		return ltype;
@@ -250,6 +272,24 @@ public:
 		return tclass & (ARRAY | VEC);
 	}
 
+	/**
+	 * @return true if the type is an array of a soa struct, stored as
+	 * a struct with an array for each member
+	 */
+	bool isSoa() const
+	{
+		return tclass & SOA;
+	}
+
+	/**
+	 * @return true if the type is a slice, stored as a pointer to the
+	 * elements and the number of elements
+	 */
+	bool isSlice() const
+	{
+		return tclass & SLICE;
+	}
+
 	bool isStruct() const
 	{
 		return tclass & STRUCT;
@@ -266,7 +306,7 @@ public:
 	 */
 	bool isComplex() const
 	{
-		return tclass & (ARRAY | STRUCT | UNION | FUNCTION);
+		return tclass & (ARRAY | STRUCT | UNION | FUNCTION | SLICE);
 	}
 
 	bool isPointer() const
@@ -284,6 +324,11 @@ public:
 		return tclass & COPY_REF;
 	}
 
+	bool isAsync() const
+	{
+		return tclass & ASYNC;
+	}
+
 	bool isEnum() const
 	{
 		return tclass & ENUM;
@@ -299,6 +344,20 @@ public:
 		return tclass & TEMPLATED;
 	}
 
+	/**
+	 * @return true if the type is a constant value bound to a template
+	 * parameter, the value's type is the subtype
+	 */
+	bool isConstValue() const
+	{
+		return tclass & CONST_VALUE;
+	}
+
+	int64_t constValue() const
+	{
+		return tsize;
+	}
+
 	bool isConstructable();
 
 	bool isDestructable();
@@ -321,12 +380,23 @@ public:
 		if (isConst())
 			os << "const ";
 
-		if (isArray()) {
+		if (isConstValue()) {
+			if (subtype->isBool())
+				os << (tsize? "true" : "false");
+			else if (subtype->isUnsigned())
+				os << tsize;
+			else
+				os << constValue();
+		} else if (isArray()) {
 			os << "[";
 			auto sz = size();
 			if (sz)
 				os << sz;
 			os << "]" << subtype->str(context);
+		} else if (isSlice()) {
+			os << "[:]" << subtype->str(context);
+		} else if (isAsync()) {
+			os << "async<" << subtype->str(context) << ">";
 		} else if (isPointer()) {
 			os << "@" << subtype->str(context);
 		} else if (isCopyRef()) {
@@ -366,12 +436,24 @@ public:
 		if (isConst())
 			os << "c_";
 
-		if (isArray()) {
+		if (isConstValue()) {
+			// the value's type keeps true and 1 from naming the same instance
+			os << "n";
+			if (!subtype->isUnsigned() && constValue() < 0)
+				os << "m" << -constValue();
+			else
+				os << tsize;
+			os << "_" << subtype->raw();
+		} else if (isArray()) {
 			os << "a";
 			auto sz = size();
 			if (sz)
 				os << sz;
 			os << "_" << subtype->raw();
+		} else if (isSlice()) {
+			os << "s_" << subtype->raw();
+		} else if (isAsync()) {
+			os << "y_" << subtype->raw();
 		} else if (isPointer()) {
 			os << "p_" << subtype->raw();
 		} else if (isReference()) {
@@ -450,7 +532,7 @@ public:
 
 	static SUnionType* createUnion(CodeContext& context, const string& name, const VecSType& templateArgs);
 
-	static void setBody(CodeContext& context, STemplatedType* type, const vector<pair<string, SType*>>& structure);
+	static void setBody(CodeContext& context, STemplatedType* type, const vector<pair<string, SType*>>& structure, bool packed = false, uint64_t align = 0, bool soa = false);
 
 	static void createEnum(CodeContext& context, const string& name, const vector<pair<string, int64_t>>& structure, SType* type);
 };
@@ -479,8 +561,11 @@ public:
 
 class STemplatedType : public SUserType
 {
+	friend class TypeManager;
+
 protected:
 	VecSType templateArgs;
+	uint64_t align = 0;
 
 	STemplatedType(const string& tName, int typeClass, const VecSType& templateArgs)
 	: SUserType(tName, typeClass | OPAQUE | (templateArgs.size() ? TEMPLATED : 0), nullptr, 0), templateArgs(templateArgs) {}
@@ -498,6 +583,15 @@ public:
 	{
 		return templateArgs;
 	}
+
+	/**
+	 * @return the alignment required by an align attribute, or 0 if
+	 * the type only needs its natural alignment
+	 */
+	uint64_t getAlign() const
+	{
+		return align;
+	}
 };
 
 class SStructType : public STemplatedType
@@ -510,6 +604,7 @@ class SStructType : public STemplatedType
 
 protected:
 	container items;
+	bool soa = false;
 
 	SStructType(const string& sName, const VecSType& args, int ctype = STRUCT)
 	: STemplatedType(sName, ctype, args) {}
@@ -528,6 +623,14 @@ public:
 
 	string str(const CodeContext& context) const override;
 
+	/**
+	 * @return true if sized arrays of the struct are stored as a struct of member arrays
+	 */
+	bool isSoaStruct() const
+	{
+		return soa;
+	}
+
 	const_iterator begin() const
 	{
 		return items.begin();
@@ -716,6 +819,12 @@ class TypeManager
 	map<pair<SType*, uint64_t>, STypePtr> arrMap;
 	map<pair<SType*, uint64_t>, STypePtr> vecMap;
 
+	// slice types
+	map<SType*, STypePtr> sliceMap;
+
+	// template constant values
+	map<pair<SType*, int64_t>, STypePtr> constValMap;
+
 	// pointer types
 	map<SType*, STypePtr> ptrMap;
 
@@ -725,6 +834,9 @@ class TypeManager
 	// copy reference types
 	map<SType*, STypePtr> cpyRefMap;
 
+	// async function result types
+	map<SType*, STypePtr> asyncMap;
+
 	// user types
 	map<string, SUserPtr> usrMap;
 
@@ -742,6 +854,18 @@ public:
 		return datalayout.getTypeAllocSize(*stype);
 	}
 
+	uint64_t userAlign(SType* stype)
+	{
+		while (stype->isArray())
+			stype = stype->subtype;
+		return stype->tclass & (SType::STRUCT | SType::UNION) ? static_cast<STemplatedType*>(stype)->align : 0;
+	}
+
+	uint64_t allocAlign(SType* stype)
+	{
+		return max<uint64_t>(datalayout.getABITypeAlignment(*stype), userAlign(stype));
+	}
+
 	SType* getSuffixType(const string& name)
 	{
 		auto suf = suffix.find(name);
@@ -805,12 +929,18 @@ public:
 
 	SType* getVec(SType* vecType, int64_t size);
 
+	SType* getSlice(SType* elType);
+
+	SType* getConstValue(SType* valueType, int64_t value);
+
 	SType* getPointer(SType* ptrType);
 
 	SType* getReference(SType* type);
 
 	SType* getCopyRef(SType* type);
 
+	SType* getAsync(SType* promiseType);
+
 	SFunctionType* getFunction(SType* returnTy, VecSType args);
 
 	SUserType* lookupUserType(const string& name)
@@ -830,7 +960,7 @@ public:
 
 	void createAlias(const string& name, SType* type);
 
-	void setBody(STemplatedType* type, const vector<pair<string, SType*>>& structure);
+	void setBody(STemplatedType* type, const vector<pair<string, SType*>>& structure, bool packed, uint64_t align, bool soa);
 
 	SStructType* createStruct(const string& name, const string& rawName, const VecSType& templateArgs);
 
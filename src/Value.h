@@ -28,10 +28,11 @@ class RValue
 	SType* ty;
 	NAttributeList* atrs;
 	bool moved;
+	bool atomic;
 
 protected:
 	RValue(Value* value, SType* type, NAttributeList* attrs)
-	: val(value), ty(type), atrs(attrs), moved(false) {}
+	: val(value), ty(type), atrs(attrs), moved(false), atomic(false) {}
 
 public:
 	RValue()
@@ -114,6 +115,20 @@ public:
 		return moved;
 	}
 
+	/**
+	 * marks a variable declared #[atomic], its loads and
+	 * stores use atomic instructions
+	 */
+	void setAtomic(bool val)
+	{
+		atomic = val;
+	}
+
+	bool isAtomic() const
+	{
+		return atomic;
+	}
+
 	SType* castToSubtype()
 	{
 		auto sub = ty->subType();
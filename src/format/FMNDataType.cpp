@@ -27,10 +27,12 @@ string FMNDataType::visit(NDataType* type)
 	VISIT_CASE_RETURN(NArrayType, type)
 	VISIT_CASE_RETURN(NBaseType, type)
 	VISIT_CASE_RETURN(NConstType, type)
+	VISIT_CASE_RETURN(NConstValueType, type)
 	VISIT_CASE_RETURN(NFuncPointerType, type)
 	VISIT_CASE_RETURN(NPointerType, type)
 	VISIT_CASE_RETURN(NReferenceType, type)
 	VISIT_CASE_RETURN(NCopyReferenceType, type)
+	VISIT_CASE_RETURN(NSliceType, type)
 	VISIT_CASE_RETURN(NThisType, type)
 	VISIT_CASE_RETURN(NUserType, type)
 	VISIT_CASE_RETURN(NVecType, type)
@@ -81,6 +83,11 @@ string FMNDataType::visitNConstType(NConstType* type)
 	return "const " + visit(type->getType());
 }
 
+string FMNDataType::visitNConstValueType(NConstValueType* type)
+{
+	return FMNExpression::run(context, type->getValue());
+}
+
 string FMNDataType::visitNThisType(NThisType* type)
 {
 	return "this";
@@ -92,6 +99,11 @@ string FMNDataType::visitNArrayType(NArrayType* type)
 	return "[" + size + "]" + visit(type->getBaseType());
 }
 
+string FMNDataType::visitNSliceType(NSliceType* type)
+{
+	return "[:]" + visit(type->getBaseType());
+}
+
 string FMNDataType::visitNVecType(NVecType* type)
 {
 	auto size = FMNExpression::run(context, type->getSize());
@@ -29,10 +29,14 @@ private:
 
 	string visitNConstType(NConstType* type);
 
+	string visitNConstValueType(NConstValueType* type);
+
 	string visitNThisType(NThisType* type);
 
 	string visitNArrayType(NArrayType* type);
 
+	string visitNSliceType(NSliceType* type);
+
 	string visitNVecType(NVecType* type);
 
 	string visitNUserType(NUserType* type);
@@ -33,6 +33,7 @@ string FMNExpression::visit(NExpression* exp)
 	VISIT_CASE_RETURN(NBaseVariable, exp)
 	VISIT_CASE_RETURN(NDereference, exp)
 	VISIT_CASE_RETURN(NMemberVariable, exp)
+	VISIT_CASE_RETURN(NSliceVariable, exp)
 	VISIT_CASE_RETURN(NAddressOf, exp)
 	VISIT_CASE_RETURN(NAssignment, exp)
 	VISIT_CASE_RETURN(NBinaryMathOperator, exp)
@@ -84,6 +85,11 @@ string FMNExpression::visitNArrayVariable(NArrayVariable* exp)
 	return visit(exp->getArrayVar()) + "[" + visit(exp->getIndex()) + "]";
 }
 
+string FMNExpression::visitNSliceVariable(NSliceVariable* exp)
+{
+	return visit(exp->getArrayVar()) + "[" + visit(exp->getStart()) + ":" + visit(exp->getEnd()) + "]";
+}
+
 string FMNExpression::visitNArrowOperator(NArrowOperator* exp)
 {
 	string line;
@@ -171,7 +177,10 @@ string FMNExpression::visitNTernaryOperator(NTernaryOperator* exp)
 
 string FMNExpression::visitNNewExpression(NNewExpression* exp)
 {
-	string line = "new " + FMNDataType::run(context, exp->getType());
+	auto alloc = FMNExpression::run(context, exp->getAllocator());
+	if (!alloc.empty())
+		alloc = "(" + alloc + ")";
+	string line = "new" + alloc + " " + FMNDataType::run(context, exp->getType());
 	auto args = exp->getArgs();
 	if (args) {
 		line += "{" + FMNExpression::run(context, args) + "}";
@@ -191,7 +200,22 @@ string FMNExpression::visitNLambdaFunction(NLambdaFunction* exp)
 		line += FMNDataType::run(context, param->getType());
 		line += " " + param->getName()->str;
 	}
-	line += "| => " + FMNDataType::run(context, exp->getReturnType()) + " {";
+	line += "|";
+	if (exp->getCaptures()) {
+		first = true;
+		line += " [";
+		for (auto capture : *exp->getCaptures()) {
+			if (!first)
+				line += ", ";
+			first = false;
+			if (capture->id() == NodeId::NAddressOf)
+				line += "$" + visit(static_cast<NAddressOf*>(capture)->getVar());
+			else
+				line += visit(capture);
+		}
+		line += "]";
+	}
+	line += " => " + FMNDataType::run(context, exp->getReturnType()) + " {";
 
 	vector<string> lines;
 	context.setBuffer(&lines);
@@ -273,6 +297,18 @@ string FMNExpression::visitNUnaryMathOperator(NUnaryMathOperator* exp)
 string FMNExpression::visitNFunctionCall(NFunctionCall* exp)
 {
 	string ret = exp->getName()->str;
+	if (exp->getTemplateArgs()) {
+		ret += "!<";
+		bool first = true;
+		for (auto item : *exp->getTemplateArgs()) {
+			if (first)
+				first = false;
+			else
+				ret += ",";
+			ret += FMNDataType::run(context, item);
+		}
+		ret += ">";
+	}
 	ret += "(";
 	bool last = false;
 	for (auto arg : *exp->getArguments()) {
@@ -26,6 +26,8 @@ class FMNExpression
 
 	string visitNArrayVariable(NArrayVariable*);
 
+	string visitNSliceVariable(NSliceVariable*);
+
 	string visitNArrowOperator(NArrowOperator*);
 
 	string visitNBaseVariable(NBaseVariable*);
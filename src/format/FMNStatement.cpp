@@ -29,6 +29,7 @@ void FMNStatement::visit(NStatement* stm)
 {
 	switch (stm->id()) {
 	VISIT_CASE(NAliasDeclaration, stm)
+	VISIT_CASE(NAwaitStatement, stm)
 	VISIT_CASE(NClassConstructor, stm)
 	VISIT_CASE(NClassDeclaration, stm)
 	VISIT_CASE(NClassDestructor, stm)
@@ -38,6 +39,7 @@ void FMNStatement::visit(NStatement* stm)
 	VISIT_CASE(NDestructorCall, stm)
 	VISIT_CASE(NEnumDeclaration, stm)
 	VISIT_CASE(NExpressionStm, stm)
+	VISIT_CASE(NForEachStatement, stm)
 	VISIT_CASE(NForStatement, stm)
 	VISIT_CASE(NFunctionDeclaration, stm)
 	VISIT_CASE(NGotoStatement, stm)
@@ -54,6 +56,7 @@ void FMNStatement::visit(NStatement* stm)
 	VISIT_CASE(NSwitchStatement, stm)
 	VISIT_CASE(NVariableDeclGroup, stm)
 	VISIT_CASE(NWhileStatement, stm)
+	VISIT_CASE(NYieldStatement, stm)
 	default:
 		cout << "NodeId::" << static_cast<int>(stm->id()) << " unrecognized in FMNStatement" << endl;
 	}
@@ -103,6 +106,7 @@ void FMNStatement::visitNExpressionStm(NExpressionStm* stm)
 
 void FMNStatement::visitNVariableDeclGroup(NVariableDeclGroup* stm)
 {
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	auto line = FMNDataType::run(context, stm->getType()) + " ";
 	bool first = true;
 	for (auto var : *stm->getVars()) {
@@ -186,7 +190,19 @@ void FMNStatement::visitNEnumDeclaration(NEnumDeclaration* stm)
 
 void FMNStatement::visitNFunctionDeclaration(NFunctionDeclaration* stm)
 {
-	WriterUtil::writeFunctionDecl(stm->getName()->str, stm->getAttrs(), stm->getRType(), stm->getParams(), nullptr, stm->getBody(), context);
+	auto name = stm->getName()->str;
+	if (stm->getTemplateParams()) {
+		name += "<";
+		bool first = true;
+		for (auto item : *stm->getTemplateParams()) {
+			if (!first)
+				name += ", ";
+			first = false;
+			name += item->str;
+		}
+		name += ">";
+	}
+	WriterUtil::writeFunctionDecl(name, stm->getAttrs(), stm->getRType(), stm->getParams(), nullptr, stm->getBody(), context);
 }
 
 void FMNStatement::visitNClassStructDecl(NClassStructDecl* stm)
@@ -249,11 +265,13 @@ void FMNStatement::visitNClassDeclaration(NClassDeclaration* stm)
 void FMNStatement::visitNReturnStatement(NReturnStatement* stm)
 {
 	auto val = stm->getValue() ? FMNExpression::run(context, stm->getValue()) : "";
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	context.addLine("return " + val + ";");
 }
 
 void FMNStatement::visitNLoopStatement(NLoopStatement* stm)
 {
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	context.addLine("loop");
 	WriterUtil::writeBlockStmt(context, stm->getBody());
 }
@@ -263,6 +281,7 @@ void FMNStatement::visitNWhileStatement(NWhileStatement* stm)
 	auto expr = FMNExpression::run(context, stm->getCond());
 	string type = stm->until() ? "until" : "while";
 
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	if (stm->doWhile()) {
 		context.addLine("do");
 	} else {
@@ -284,10 +303,13 @@ void FMNStatement::visitNSwitchStatement(NSwitchStatement* stm)
 {
 	context.addLine("switch (" + FMNExpression::run(context, stm->getValue()) + ") {");
 	for (auto s : *stm->getCases()) {
-		if (s->isValueCase()) {
-			context.addLine("case " + FMNExpression::run(context, s->getValue()) + ":");
+		auto attrs = s->getAttrs()? " " + WriterUtil::getAttr(s->getAttrs()) : "";
+		if (s->isRangeCase()) {
+			context.addLine("case" + attrs + " " + FMNExpression::run(context, s->getValue()) + ".." + FMNExpression::run(context, s->getEndValue()) + ":");
+		} else if (s->isValueCase()) {
+			context.addLine("case" + attrs + " " + FMNExpression::run(context, s->getValue()) + ":");
 		} else {
-			context.addLine("default:");
+			context.addLine("default" + attrs + ":");
 		}
 		context.indent();
 		visit(s->getBody());
@@ -303,6 +325,7 @@ void FMNStatement::visitNForStatement(NForStatement* stm)
 	visit(stm->getPreStm());
 	context.setBuffer(nullptr);
 
+	WriterUtil::writeAttr(context, stm->getAttrs());
 	context.addLine("for (");
 	context.add(accumulate(lines.begin(), lines.end(), string(), [](string& a, string& b) {
 		b.erase(b.begin(), find_if(b.begin(), b.end(), [](int ch) {
@@ -318,6 +341,15 @@ void FMNStatement::visitNForStatement(NForStatement* stm)
 	WriterUtil::writeBlockStmt(context, stm->getBody());
 }
 
+void FMNStatement::visitNForEachStatement(NForEachStatement* stm)
+{
+	WriterUtil::writeAttr(context, stm->getAttrs());
+	context.addLine("for (" + FMNDataType::run(context, stm->getType()) + " " + stm->getName()->str + " : ");
+	context.add(FMNExpression::run(context, stm->getCond()) + ")");
+
+	WriterUtil::writeBlockStmt(context, stm->getBody());
+}
+
 void FMNStatement::visitNIfStatement(NIfStatement* stm)
 {
 	vector<NIfStatement*> ifSmts;
@@ -349,11 +381,15 @@ void FMNStatement::visitNIfStatement(NIfStatement* stm)
 		auto cond = "if (" +FMNExpression::run(context, ifStmt->getCond()) + ")";
 		if (first) {
 			first = false;
+			WriterUtil::writeAttr(context, ifStmt->getAttrs());
 			context.addLine(cond);
-		} else if (useBlock) {
-			context.add(" else " + cond);
 		} else {
-			context.addLine("else " + cond);
+			if (ifStmt->getAttrs())
+				cond = WriterUtil::getAttr(ifStmt->getAttrs()) + " " + cond;
+			if (useBlock)
+				context.add(" else " + cond);
+			else
+				context.addLine("else " + cond);
 		}
 		WriterUtil::writeBlockStmt(context, ifStmt->getBody(), useBlock);
 	}
@@ -380,6 +416,19 @@ void FMNStatement::visitNGotoStatement(NGotoStatement* stm)
 	context.addLine("goto " + stm->getName()->str + ";");
 }
 
+void FMNStatement::visitNYieldStatement(NYieldStatement* stm)
+{
+	auto value = FMNExpression::run(context, stm->getValue());
+	if (!value.empty())
+		value = " " + value;
+	context.addLine("yield" + value + ";");
+}
+
+void FMNStatement::visitNAwaitStatement(NAwaitStatement* stm)
+{
+	context.addLine("await " + FMNExpression::run(context, stm->getValue()) + ";");
+}
+
 void FMNStatement::visitNLoopBranch(NLoopBranch* stm)
 {
 	string line;
@@ -406,8 +455,11 @@ void FMNStatement::visitNDeleteStatement(NDeleteStatement* stm)
 	auto size = FMNExpression::run(context, stm->getArrSize());
 	if (!size.empty())
 		size = "[" + size + "]";
+	auto alloc = FMNExpression::run(context, stm->getAllocator());
+	if (!alloc.empty())
+		alloc = "(" + alloc + ")";
 	auto var = FMNExpression::run(context, stm->getVar());
-	context.addLine("delete" + size + " " + var + ";");
+	context.addLine("delete" + size + alloc + " " + var + ";");
 }
 
 void FMNStatement::visitNDestructorCall(NDestructorCall* stm)
@@ -61,12 +61,18 @@ class FMNStatement
 
 	void visitNForStatement(NForStatement* stm);
 
+	void visitNForEachStatement(NForEachStatement* stm);
+
 	void visitNIfStatement(NIfStatement* stm);
 
 	void visitNLabelStatement(NLabelStatement* stm);
 
 	void visitNGotoStatement(NGotoStatement* stm);
 
+	void visitNYieldStatement(NYieldStatement* stm);
+
+	void visitNAwaitStatement(NAwaitStatement* stm);
+
 	void visitNLoopBranch(NLoopBranch* stm);
 
 	void visitNDeleteStatement(NDeleteStatement* stm);
@@ -22,10 +22,10 @@
 #include "FMNExpression.h"
 #include "FMNDataType.h"
 
-void WriterUtil::writeAttr(FormatContext& context, NAttributeList* attrs)
+string WriterUtil::getAttr(NAttributeList* attrs)
 {
 	if (!attrs)
-		return;
+		return "";
 
 	string data = "#[";
 	bool lastAttr = false;
@@ -51,8 +51,13 @@ void WriterUtil::writeAttr(FormatContext& context, NAttributeList* attrs)
 		}
 	}
 	data += "]";
+	return data;
+}
 
-	context.addLine(data);
+void WriterUtil::writeAttr(FormatContext& context, NAttributeList* attrs)
+{
+	if (attrs)
+		context.addLine(getAttr(attrs));
 }
 
 bool WriterUtil::isBlockStmt(NStatementList* stmts)
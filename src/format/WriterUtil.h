@@ -20,6 +20,8 @@
 class WriterUtil
 {
 public:
+	static string getAttr(NAttributeList* attrs);
+
 	static void writeAttr(FormatContext& context, NAttributeList* attrs);
 
 	static bool isBlockStmt(NStatementList* stmts);
@@ -19,6 +19,7 @@
 #include "AST.h"
 #include "CodeContext.h"
 #include "CGNStatement.h"
+#include "Builder.h"
 #include "CGNImportList.h"
 #include "ModuleWriter.h"
 #include "Util.h"
@@ -34,6 +35,12 @@ void initOptions()
 		("noverify", "do not verify module; write LLVM IR file")
 		("noclean", "do not run clean/verify on module; write LLVM IR file")
 		("print-debug", "insert debug prints in generated code")
+		("sized-free", "use free_sized/free_aligned_sized for delete when the size is known")
+		("heap-to-stack", "move small non-escaping new/delete allocations to the stack")
+		("heap-stat", "output the number of allocations moved by heap-to-stack")
+		("bounds-check", "trap on out of bounds array and slice indexes")
+		("tail-calls", "run tail call elimination, turning self recursion into loops")
+		("debug,g", value<string>()->implicit_value("full"), "generate debug info: -g or -gline-tables-only")
 		("stat", "output package and import data");
 }
 
@@ -52,13 +59,17 @@ int compile(const path& file, NStatementList* statements, variables_map& vm)
 	uPtr<Module> module(new Module(file.string(), llvmContext));
 	GlobalContext globalCtx(module.get());
 	CodeContext context(globalCtx, vm);
+	if (vm.count("debug"))
+		globalCtx.initDebugInfo(file, vm["debug"].as<string>() == "line-tables-only");
 
 	context.pushFile(file);
 	CGNStatement::run(context, COPY_NODES ? statements->copy() : statements);
+	Builder::EvalGlobalInits(context);
 	if (context.handleErrors())
 		return 2;
 
 	context.popFile();
+	globalCtx.finalizeDebugInfo();
 	ModuleWriter writer(*module.get(), file.string(), vm);
 
 	return writer.run();
@@ -79,6 +90,14 @@ int main(int argc, char** argv)
 		return 1;
 	}
 
+	if (vm.count("debug")) {
+		auto level = vm["debug"].as<string>();
+		if (level != "full" && level != "line-tables-only") {
+			cout << "invalid debug info level: " << level << endl;
+			return 1;
+		}
+	}
+
 	auto file = Util::relative(vm["input"].as<string>());
 	if (!exists(file)) {
 		cout << "file not found: " << file << endl;
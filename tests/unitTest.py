@@ -16,7 +16,7 @@
 # You should have received a copy of the GNU General Public License
 # along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
-import os, sys, fnmatch, codecs, difflib
+import os, sys, re, fnmatch, codecs, difflib
 from subprocess import Popen, PIPE
 
 SAPHYR_BIN = "../saphyr"
@@ -32,6 +32,15 @@ NEG_EXT = ".neg"
 BC_EXT = ".bc"
 OBJ_EXT = ".o"
 
+# compiler options enabled by a comment in the test's header
+HEADER_OPTS = {
+	"print-debug": "--print-debug",
+	"sized-free": "--sized-free",
+	"heap-to-stack": "--heap-to-stack",
+	"bounds-check": "--bounds-check",
+	"debug-info": "-g"
+}
+
 class Cmd:
 	def __init__(self, cmd):
 		p = Popen(cmd, stdout=PIPE, stderr=PIPE)
@@ -70,7 +79,8 @@ def patchAsm(filename):
 	with open(filename, "r") as asm:
 		for line in asm:
 			if not "; ModuleID" in line and not "source_filename" in line:
-				data += line
+				# debug info file paths depend on where the tests are run
+				data += re.sub(r'directory: "[^"]*"', 'directory: ""', line)
 	data = data.strip() + "\n"
 	with open(filename, "w") as asm:
 		asm.write(data)
@@ -162,9 +172,12 @@ class TestCase:
 			line = file.readline() + file.readline()
 		return line
 
-	def runFmt(self):
+	def getOptions(self):
 		header = self.getHeader()
-		if header.find("nofmt") != -1 or header.find("print-debug") != -1:
+		return [opt for key, opt in HEADER_OPTS.items() if header.find(key) != -1]
+
+	def runFmt(self):
+		if self.getHeader().find("nofmt") != -1 or self.getOptions():
 			return False, None
 
 		proc = Cmd([SYFMT_BIN, self.srcFile])
@@ -188,9 +201,7 @@ class TestCase:
 		if ret[0]:
 			return ret
 
-		cmdline = [SAPHYR_BIN]
-		if self.getHeader().find("print-debug") != -1:
-			cmdline.append("--print-debug")
+		cmdline = [SAPHYR_BIN] + self.getOptions()
 		cmdline.extend(["--llvmir", self.srcFile])
 
 		proc = Cmd(cmdline)